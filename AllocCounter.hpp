@@ -0,0 +1,38 @@
+// Heap allocation counter
+/*
+    Replaces the global operator new and operator delete of the program that includes it,
+    so that benchmarks and checks can tell how many heap allocations a piece of code makes:
+
+        const size_t before = alloc::count();
+        ...
+        const size_t allocations = alloc::count() - before;
+
+    Replacement allocation functions cannot be inline: include this header from exactly
+    one translation unit per program (each demo is a single file).
+    The operators are kept out of line: GCC otherwise inlines free() next to a `new` call
+    site and reports a spurious -Wmismatched-new-delete.
+*/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace alloc {
+
+inline std::atomic<size_t> allocations{0};
+
+/** Calls to operator new since the program started, over all the threads */
+inline auto count() -> size_t { return allocations.load(std::memory_order_relaxed); }
+
+} // namespace alloc
+
+[[gnu::noinline]] void* operator new(std::size_t size)
+{
+    alloc::allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1)){ return p; }
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,464 @@
+// Asynchronous binary logger
+/*
+    Shared by the demos in place of their synchronous Log/LOGI/LOGT helpers, which formatted
+    to std::cout on the calling thread (LOGT even inside constructors and destructors).
+
+    Two levels of filtering:
+      - compile time: levels below ALOG_MIN_LEVEL (default 0 = Trace, everything compiled in)
+        are removed by ALOG(); the arguments are not even evaluated.
+            g++ -DALOG_MIN_LEVEL=2 ...   => Trace and Debug calls generate no code
+      - run time: setMuted(true) makes enabled calls return right away (benchmarks use it).
+
+    Enabled calls take the deferred-formatting path: the caller only copies its arguments,
+    in binary form, into a lock-free ring owned by its thread (single producer, single
+    consumer), together with a pointer to the decoder instantiated for the argument types.
+    A background thread drains the rings, formats the records and writes them to the sink.
+      - arithmetic values, enums, pointers and stream manipulators (std::setw, std::fixed...)
+        are trivially copyable and stored as they are
+      - strings (std::string, std::string_view, C strings) are stored as length + bytes
+      - anything else is formatted on the caller thread, as a fallback
+    Records of one thread are written in order; records of different threads may interleave.
+    A caller finding its ring full waits for the background thread: nothing is dropped,
+    except a record larger than the whole ring (1 MiB), which cannot be stored; such records
+    are counted and reported in the output by the background thread.
+    While every ring is empty the background thread sleeps, and polls again every
+    PollInterval (5 ms). Callers do not wake it per record: only a record taking its ring
+    past a quarter full, a full ring and flush() wake it, so the common call is the copy
+    and a release store.
+    Output written directly to stdout must call flush() first to keep its place.
+*/
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+#ifndef ALOG_MIN_LEVEL
+#define ALOG_MIN_LEVEL 0
+#endif
+
+namespace alog {
+
+enum class Level: int { Trace = 0, Debug = 1, Info = 2, Warn = 3, Error = 4 };
+
+constexpr auto enabled(Level level) -> bool
+{
+    return static_cast<int>(level) >= ALOG_MIN_LEVEL;
+}
+
+namespace detail {
+
+using Decoder = void (*)(const std::byte* payload, std::ostream& out);
+
+struct RecordHeader
+{
+    Decoder       decode; // nullptr marks the padding skipped at the end of the ring
+    std::uint32_t size;   // header included, multiple of RecordAlign
+};
+
+constexpr size_t RecordAlign = 16;
+static_assert(sizeof(RecordHeader) <= RecordAlign);
+
+//------- Argument encoding -------//
+
+template<typename T>
+constexpr bool isString = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>
+                       || std::is_same_v<T, const char*> || std::is_same_v<T, char*>;
+
+template<typename T>
+constexpr bool isRaw = !isString<T> && std::is_trivially_copyable_v<T>;
+
+// Type the decoder reads back for a captured argument of type T
+template<typename T>
+using Stored = std::conditional_t<isString<T>, std::string_view, T>;
+
+// Arguments neither raw nor strings are formatted right away
+template<typename T>
+auto capture(const T& arg) -> decltype(auto)
+{
+    if constexpr(isString<T> || isRaw<T>){
+        return (arg);
+    } else {
+        std::ostringstream text;
+        text << arg;
+        return text.str();
+    }
+}
+
+inline auto asView(std::string_view text) -> std::string_view { return text; }
+inline auto asView(const char* text) -> std::string_view { return text ? text : "(null)"; }
+
+template<typename T>
+auto encodedSize(const T& arg) -> size_t
+{
+    if constexpr(isRaw<T>){
+        return sizeof(T);
+    } else {
+        return sizeof(std::uint32_t) + asView(arg).size();
+    }
+}
+
+template<typename T>
+auto encode(std::byte*& p, const T& arg) -> void
+{
+    if constexpr(isRaw<T>){
+        std::memcpy(p, &arg, sizeof(T));
+        p += sizeof(T);
+    } else {
+        const std::string_view text = asView(arg);
+        const auto length = static_cast<std::uint32_t>(text.size());
+        std::memcpy(p, &length, sizeof(length));
+        std::memcpy(p + sizeof(length), text.data(), length);
+        p += sizeof(length) + length;
+    }
+}
+
+template<typename S>
+auto decode(const std::byte*& p, std::ostream& out) -> void
+{
+    if constexpr(std::is_same_v<S, std::string_view>){
+        std::uint32_t length;
+        std::memcpy(&length, p, sizeof(length));
+        out << std::string_view(reinterpret_cast<const char*>(p + sizeof(length)), length); // honors std::setw
+        p += sizeof(length) + length;
+    } else {
+        std::array<std::byte, sizeof(S)> bytes;
+        std::memcpy(bytes.data(), p, sizeof(S));
+        out << std::bit_cast<S>(bytes);
+        p += sizeof(S);
+    }
+}
+
+template<typename... S>
+auto decodeRecord(const std::byte* payload, std::ostream& out) -> void
+{
+    ((decode<S>(payload, out)), ...);
+    out << '\n';
+}
+
+//------- Per-thread ring -------//
+
+// Single producer (the owning thread), single consumer (the background thread).
+// Positions only grow, the offset in the buffer is position % Capacity.
+class ByteRing
+{
+public:
+    static constexpr size_t Capacity = size_t(1) << 20;
+    static constexpr size_t WakeThreshold = Capacity / 4;
+
+    ByteRing(): m_buffer(new std::byte[Capacity]) { }
+
+    /** Returns false if the record is larger than the whole ring and was dropped.
+        wake() is called before waiting for the consumer to free some room, and when
+        this record takes the ring past WakeThreshold. */
+    template<typename Encode, typename Wake>
+    auto push(size_t payloadSize, Decoder decoder, Encode&& encodePayload, Wake&& wake) -> bool
+    {
+        const size_t size = (RecordAlign + payloadSize + RecordAlign - 1) / RecordAlign * RecordAlign;
+        if(size > Capacity){
+            m_oversized.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        size_t head = m_head.load(std::memory_order_relaxed);
+        bool stalled = false;
+        const size_t toEnd = Capacity - head % Capacity;
+        if(toEnd < size){
+            // Records never wrap: skip to offset 0 first, which only needs room for the padding
+            waitForSpace(head, toEnd, stalled, wake);
+            writeHeader(head, RecordHeader{nullptr, static_cast<std::uint32_t>(toEnd)});
+            head += toEnd;
+            m_head.store(head, std::memory_order_release);
+        }
+        waitForSpace(head, size, stalled, wake);
+        writeHeader(head, RecordHeader{decoder, static_cast<std::uint32_t>(size)});
+        std::byte* payload = &m_buffer[head % Capacity + RecordAlign];
+        encodePayload(payload);
+        m_head.store(head + size, std::memory_order_release);
+        if(head + size - m_cachedTail >= WakeThreshold && head - m_cachedTail < WakeThreshold){
+            // Crossed the threshold in the producer's view; check against the real tail
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if(head + size - m_cachedTail >= WakeThreshold){ wake(); }
+        }
+        return true;
+    }
+
+    /** Consumer side: format every complete record. Returns the number of records. */
+    auto drain(std::ostream& out) -> size_t
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        size_t records = 0;
+        while(tail != head){
+            RecordHeader header;
+            std::memcpy(&header, &m_buffer[tail % Capacity], sizeof(header));
+            if(header.decode){
+                header.decode(&m_buffer[tail % Capacity + RecordAlign], out);
+                ++records;
+            }
+            tail += header.size;
+        }
+        m_tail.store(tail, std::memory_order_release);
+        return records;
+    }
+
+    auto empty() const -> bool
+    {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+    /** Number of times the producer found the ring full and had to wait */
+    auto stalls() const -> size_t { return m_stalls.load(std::memory_order_relaxed); }
+
+    /** Records dropped because they were larger than the ring */
+    auto oversized() const -> size_t { return m_oversized.load(std::memory_order_relaxed); }
+
+    std::atomic<bool> abandoned{false}; // producer thread exited
+private:
+    // Wait until `size` bytes from `head` are free. The consumer may be asleep with
+    // records or padding still in the ring: it is woken before waiting.
+    template<typename Wake>
+    auto waitForSpace(size_t head, size_t size, bool& stalled, Wake& wake) -> void
+    {
+        if(head + size - m_cachedTail <= Capacity){ return; }
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        if(head + size - m_cachedTail <= Capacity){ return; }
+        if(!stalled){
+            m_stalls.fetch_add(1, std::memory_order_relaxed);
+            stalled = true;
+        }
+        wake();
+        do {
+            std::this_thread::yield();
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+        } while(head + size - m_cachedTail > Capacity);
+    }
+
+    auto writeHeader(size_t position, const RecordHeader& header) -> void
+    {
+        std::memcpy(&m_buffer[position % Capacity], &header, sizeof(header));
+    }
+
+    alignas(64) std::atomic<size_t> m_head{0};
+    size_t                          m_cachedTail{0}; // producer's last view of m_tail
+    std::atomic<size_t>             m_stalls{0};
+    std::atomic<size_t>             m_oversized{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    std::unique_ptr<std::byte[]>    m_buffer;
+};
+
+} // namespace detail
+
+class Logger
+{
+public:
+    static auto instance() -> Logger&
+    {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Sleep of the background thread while every ring is empty
+    static constexpr std::chrono::milliseconds PollInterval{5};
+
+    // Everything logged before exit is written
+    ~Logger()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_wakeMutex};
+            m_stop.store(true, std::memory_order_release);
+        }
+        m_wakeCondition.notify_one();
+        m_worker.join();
+    }
+
+    /** Ring of the calling thread, created on its first call */
+    auto ring() -> detail::ByteRing&
+    {
+        struct Producer
+        {
+            std::shared_ptr<detail::ByteRing> ring;
+            ~Producer() { ring->abandoned.store(true, std::memory_order_release); }
+        };
+        thread_local Producer producer{attach()};
+        return *producer.ring;
+    }
+
+    /** Wait until every record logged so far is written */
+    auto flush() -> void
+    {
+        wake();
+        for(;;){
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                bool empty = true;
+                for(const auto& ring: m_rings){ empty = empty && ring->empty(); }
+                if(empty){
+                    m_sink->flush(); // drainAll() holds the mutex while writing
+                    return;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /** Write to another stream from now on (std::cout by default).
+        The background thread only touches the sink while holding the mutex taken here,
+        so the previous stream is no longer used once redirect() returns. */
+    auto redirect(std::ostream& sink) -> void
+    {
+        flush();
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_sink->flush();
+        m_sink = &sink;
+    }
+
+    /** Drain the rings now rather than at the next poll. Rare: a ring filling up, flush() */
+    auto wake() -> void
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_wakeMutex};
+            m_wakeRequested = true;
+        }
+        m_wakeCondition.notify_one();
+    }
+
+    auto setMuted(bool muted) -> void { m_muted.store(muted, std::memory_order_relaxed); }
+    auto muted() const -> bool { return m_muted.load(std::memory_order_relaxed); }
+
+    /** Times a caller found its ring full, over all the threads */
+    auto stalls() -> size_t
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        size_t total = m_retiredStalls;
+        for(const auto& ring: m_rings){ total += ring->stalls(); }
+        return total;
+    }
+
+    /** Records dropped because they were larger than a ring, over all the threads */
+    auto oversized() -> size_t
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return oversizedLocked();
+    }
+private:
+    Logger(): m_worker([this]{ run(); }) { }
+
+    auto attach() -> std::shared_ptr<detail::ByteRing>
+    {
+        auto ring = std::make_shared<detail::ByteRing>();
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_rings.push_back(ring);
+        return ring;
+    }
+
+    auto oversizedLocked() const -> size_t
+    {
+        size_t total = m_retiredOversized;
+        for(const auto& ring: m_rings){ total += ring->oversized(); }
+        return total;
+    }
+
+    auto drainAll() -> size_t
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        std::ostream& out = *m_sink;
+        size_t records = 0;
+        for(size_t i = 0; i < m_rings.size(); ){
+            const bool abandoned = m_rings[i]->abandoned.load(std::memory_order_acquire);
+            records += m_rings[i]->drain(out);
+            if(abandoned){
+                m_retiredStalls += m_rings[i]->stalls();
+                m_retiredOversized += m_rings[i]->oversized();
+                m_rings.erase(m_rings.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+        const size_t oversized = oversizedLocked();
+        if(oversized != m_reportedOversized){
+            out << "[alog] " << oversized - m_reportedOversized << " record(s) larger than the ring dropped\n";
+            m_reportedOversized = oversized;
+        }
+        return records;
+    }
+
+    auto run() -> void
+    {
+        for(;;){
+            if(drainAll() != 0){ continue; }
+            if(m_stop.load(std::memory_order_acquire)){ break; }
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_sink->flush();
+            }
+            // A record pushed meanwhile without a wake waits for the next poll at most
+            std::unique_lock<std::mutex> lock{m_wakeMutex};
+            m_wakeCondition.wait_for(lock, PollInterval, [this]{
+                return m_wakeRequested || m_stop.load(std::memory_order_relaxed);
+            });
+            m_wakeRequested = false;
+        }
+        drainAll();
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_sink->flush();
+    }
+
+    std::mutex                                     m_mutex;   // guards the rings list and the sink
+    std::vector<std::shared_ptr<detail::ByteRing>> m_rings;
+    size_t                                         m_retiredStalls{0};
+    size_t                                         m_retiredOversized{0};
+    size_t                                         m_reportedOversized{0};
+    std::ostream*                                  m_sink{&std::cout};
+    std::atomic<bool>                              m_muted{false};
+    std::atomic<bool>                              m_stop{false};
+    std::mutex                                     m_wakeMutex;
+    std::condition_variable                        m_wakeCondition;
+    bool                                           m_wakeRequested{false}; // guarded by m_wakeMutex
+    std::thread                                    m_worker; // last: starts once the rest is built
+};
+
+template<typename... S>
+auto writeCaptured(const S&... args) -> void
+{
+    const size_t size = (size_t(0) + ... + detail::encodedSize(args));
+    Logger& logger = Logger::instance();
+    logger.ring().push(size, &detail::decodeRecord<detail::Stored<S>...>,
+        [&](std::byte* p){ ((detail::encode(p, args)), ...); },
+        [&]{ logger.wake(); });
+}
+
+/** Log one line made of the arguments, as `std::cout << args...` would */
+template<Level L, typename... T>
+auto write(const T&... args) -> void
+{
+    if constexpr(enabled(L)){
+        if(Logger::instance().muted()){ return; }
+        writeCaptured(detail::capture<std::decay_t<const T&>>(args)...);
+    }
+}
+
+inline auto flush() -> void { Logger::instance().flush(); }
+inline auto setMuted(bool muted) -> void { Logger::instance().setMuted(muted); }
+
+} // namespace alog
+
+// Compile-time filtered log statement: below ALOG_MIN_LEVEL the arguments are not evaluated
+#define ALOG(level, ...) \
+    do { if constexpr(::alog::enabled(level)){ ::alog::write<level>(__VA_ARGS__); } } while(0)
@@ -21,12 +21,13 @@
 #include <iostream>
 #include <string>
 
+#include "AsyncLog.hpp"
+
 template <typename ...T> //variadic template
 void Log(T&&... args) //rvalue ref
 {
-    //warning: fold-expressions only available with '-std=c++17' or '-std=gnu++17'
-    ((std::cout << args), ...); 
-    std::cout<<'\n';
+    // Formatted and written by the background thread of AsyncLog.hpp
+    alog::write<alog::Level::Info>(args...);
 }
 
 // Function meta object 
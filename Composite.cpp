@@ -33,6 +33,9 @@ Composite
 #include <memory>
 #include <vector>
 
+#include "AsyncLog.hpp"
+#include "Trace.hpp"
+
 //Component interface:
 //Defines primitive elements operations.
 class IGraphic{
@@ -57,11 +60,11 @@ private:
 
 public:
     Group(const std::string& id): id(id) {
-        std::cout << " [TRACE] Create group = " << id << "\n";
+        ALOG(alog::Level::Trace, " [TRACE] Create group = ", id);
     }
 
     ~Group(){
-        std::cout << " [TRACE] Destroy group - id = << " << id << "\n";
+        ALOG(alog::Level::Trace, " [TRACE] Destroy group - id = << ", id);
     }
 
     auto begin() const -> decltype(nodes.begin()) {
@@ -81,22 +84,19 @@ public:
     }
 
     auto add(GNode n) -> void {
-        std::cout << " [TRACE] id = " << id
-                  << "; Add object = " << n->type() << "\n";
+        ALOG(alog::Level::Trace, " [TRACE] id = ", id, "; Add object = ", n->type());
        nodes.push_back(n);
     }
 
     //raw pointer version
     auto add(IGraphic* n) -> void {
-        std::cout << " [TRACE] id = " << id
-                  << " ; Add object = " << n->type() << "\n";
+        ALOG(alog::Level::Trace, " [TRACE] id = ", id, " ; Add object = ", n->type());
         nodes.push_back(std::shared_ptr<IGraphic>(n));
     }
 
     // Add stack-allocated object 
     auto addFromStack(IGraphic* n) -> void {
-        std::cout << " [TRACE] id = " << id
-                  << " ; Add object = " << n->type() << "\n";
+        ALOG(alog::Level::Trace, " [TRACE] id = ", id, " ; Add object = ", n->type());
         // Dummy deleter to avoid core dump by avoiding deleting
         // stack-allocated object or non-owned pointer.
         auto s = std::shared_ptr<IGraphic>(n, [](IGraphic*){ return ; });
@@ -107,8 +107,7 @@ public:
     template<class Node>
     auto addNew(const std::string& id) -> void {
         auto n = std::make_unique<Node>(id);
-        std::cout << " [TRACE] id = " << id
-                          << " ; Add object = " << n->type() << "\n";    
+        ALOG(alog::Level::Trace, " [TRACE] id = ", id, " ; Add object = ", n->type());
         nodes.push_back(std::move(n));//Just move the ownership of unique to shared pointer
     }
 
@@ -119,12 +118,13 @@ public:
     }
 
     auto draw() -> void override {
-        std::cout << " [TRACE] Draw group - id =  " << id << "\n";
+        TRACE_SCOPE("Group::draw");
+        ALOG(alog::Level::Trace, " [TRACE] Draw group - id =  ", id);
         for(const auto& obj: nodes)
             obj->draw();
     }
     auto rotate(double angle) -> void override {
-        std::cout << " [TRACE] Rotate group - id = " << id << "\n";
+        ALOG(alog::Level::Trace, " [TRACE] Rotate group - id = ", id);
         for(const auto& obj: nodes)
             obj->rotate(angle);
     }    
@@ -142,11 +142,11 @@ public:
          return ltype;
     } 
     auto draw() -> void override {
-         std::cout << " [TRACE] Draw line - id = " << id << "\n";
+         TRACE_SCOPE("Line::draw");
+         ALOG(alog::Level::Trace, " [TRACE] Draw line - id = ", id);
     } 
     auto rotate(double angle) -> void override {
-         std::cout << " [TRACE] Rotate line ; id = " << id 
-                   << "; angle = " << angle << "\n";
+         ALOG(alog::Level::Trace, " [TRACE] Rotate line ; id = ", id, "; angle = ", angle);
     }  
 };
 
@@ -161,12 +161,11 @@ public:
        return ttype;
     } 
     auto draw() -> void override {
-        std::cout << " [TRACE] Draw triangle - id = " << _id << "\n";
+        TRACE_SCOPE("Triangle::draw");
+        ALOG(alog::Level::Trace, " [TRACE] Draw triangle - id = ", _id);
     } 
     auto rotate(double angle) -> void override {
-         std::cout << " [TRACE] Rotate triangle"
-                   << " id = " << _id
-                   << " angle = " << angle << "\n";
+         ALOG(alog::Level::Trace, " [TRACE] Rotate triangle", " id = ", _id, " angle = ", angle);
     }  
 };
 
@@ -184,10 +183,13 @@ auto countElements(const Group& group) -> size_t {
 }
 
 
-int main(){
+int main(int argc, char** argv){
     
     const char nl = '\n';
-    std::cout << "=== Objects construction === " << nl;
+    // --trace=FILE records the draw() walks as spans
+    const auto traceFile = trace::fileFromArgs(argc, argv);
+    trace::setEnabled(traceFile.has_value());
+    ALOG(alog::Level::Info, "=== Objects construction === ");
 
     auto groupA = Group("groupA");
     groupA.add(new Triangle("triangleA1"));
@@ -203,27 +205,31 @@ int main(){
     groupB->addFromStack(&triangleB3);
     groupA.add(groupB);
 
-    std::cout << nl << "=== End of object construction === " << nl;
-    std::cout << "Total of elements of groupA = " << countElements(groupA) << "\n";
-    std::cout << "Total of elements of groupB = " << countElements(*groupB) << "\n";
+    ALOG(alog::Level::Info, nl, "=== End of object construction === ");
+    ALOG(alog::Level::Info, "Total of elements of groupA = ", countElements(groupA));
+    ALOG(alog::Level::Info, "Total of elements of groupB = ", countElements(*groupB));
 
-    std::cout << nl << " [*] ==> Draw group B" << "\n";
+    ALOG(alog::Level::Info, nl, " [*] ==> Draw group B");
     groupB->draw();
 
-    std::cout << nl << " [*] ==> Rotate group B" << "\n";
+    ALOG(alog::Level::Info, nl, " [*] ==> Rotate group B");
     groupB->rotate(90);
 
-    std::cout << nl << " [*] ==> Draw group A" << "\n";
+    ALOG(alog::Level::Info, nl, " [*] ==> Draw group A");
     groupA.draw();
 
-    std::cout << nl << " [*] ==> Rotate group A" << "\n";
+    ALOG(alog::Level::Info, nl, " [*] ==> Rotate group A");
     groupA.rotate(15);
 
-    std::cout << nl << " [*] ==> Remove objects from group B" << "\n";
+    ALOG(alog::Level::Info, nl, " [*] ==> Remove objects from group B");
     groupB->clear();
     groupA.draw();
 
-    std::cout << "=== End of Program ====" << "\n";
+    if(traceFile){
+        const bool saved = trace::save(*traceFile);
+        ALOG(alog::Level::Info, (saved ? "Trace written to " : "Cannot write the trace to "), *traceFile);
+    }
+    ALOG(alog::Level::Info, "=== End of Program ====");
 
     return EXIT_SUCCESS;
 }
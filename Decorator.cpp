@@ -29,24 +29,134 @@
 */
 
 #include <iostream>
+#include <iomanip>
 #include <string>
 #include <memory>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <charconv>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <tuple>
+#include <memory_resource>
+#include <optional>
+#include <cmath>
+#include <bit>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "AsyncLog.hpp"
+#include "Trace.hpp"
+#include "AllocCounter.hpp"
+
+// The transform kernels are compared bit for bit against the scalar loops, so a rotation
+// such as cosA * px - sinA * py must not become an FMA. GCC contracts by default in GNU mode
+// when -march has FMA, Clang within a statement: off for this file (same as -ffp-contract=off).
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
 
 template <typename ...T> //variadic template
 void Log(T&&... args) //rvalue ref
 {
-    //warning: fold-expressions only available with '-std=c++17' or '-std=gnu++17'
-    ((std::cout << args), ...); 
-    std::cout<<'\n';
+    // Formatted and written by the background thread of AsyncLog.hpp
+    alog::write<alog::Level::Info>(args...);
+}
+
+// Append an integer to a string without a temporary std::string
+inline auto appendInt(std::string& out, int value) -> void
+{
+    char digits[16];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
 }
 
+// Draw commands: a shape chain compiled into a flat, contiguous stream
+enum class DrawOp: std::uint8_t { PushColor, PopColor, PushTransform, PopTransform, DrawPrimitive };
+enum class Primitive: std::uint32_t { Square, Triangle };
+
+struct DrawCommand
+{
+    DrawOp        op;
+    std::uint32_t arg;     // color id for PushColor, Primitive for DrawPrimitive
+    int           x, y;    // offset for PushTransform
+};
+
+class CommandList
+{
+public:
+    auto pushColor(const std::string& color) -> void
+    {
+        m_commands.push_back({DrawOp::PushColor, colorId(color), 0, 0});
+    }
+    auto popColor() -> void      { m_commands.push_back({DrawOp::PopColor, 0, 0, 0}); }
+    auto pushTransform(int x, int y) -> void
+    {
+        m_commands.push_back({DrawOp::PushTransform, 0, x, y});
+    }
+    auto popTransform() -> void  { m_commands.push_back({DrawOp::PopTransform, 0, 0, 0}); }
+    auto drawPrimitive(Primitive primitive) -> void
+    {
+        m_commands.push_back({DrawOp::DrawPrimitive, static_cast<std::uint32_t>(primitive), 0, 0});
+    }
+
+    auto commands() const -> const std::vector<DrawCommand>& { return m_commands; }
+    auto colorName(std::uint32_t id) const -> const std::string& { return m_palette[id]; }
+    auto clear() -> void { m_commands.clear(); }
+private:
+    // Colors are interned, commands only carry a small id
+    auto colorId(const std::string& color) -> std::uint32_t
+    {
+        for(std::uint32_t i = 0; i < m_palette.size(); ++i){
+            if(m_palette[i] == color){ return i; }
+        }
+        m_palette.push_back(color);
+        return static_cast<std::uint32_t>(m_palette.size() - 1);
+    }
+
+    std::vector<DrawCommand> m_commands;
+    std::vector<std::string> m_palette;
+};
+
 // Interface IShape (IComponent) 
 struct IShape
 {
   //optional:  -> return type
   virtual auto draw() -> void = 0;
-  virtual auto description() -> std::string = 0;
+  // Append the draw commands of this shape and of the shapes it decorates
+  virtual auto compileTo(CommandList& out) -> void = 0;
+  // Append the description of this shape to out, in a single pass over the chain
+  virtual auto describeTo(std::string& out) -> void = 0;
+  // Changes whenever this shape, or a shape it decorates, is modified
+  virtual auto revision() const -> unsigned long = 0;
   virtual ~IShape() = default;
+
+  // Cached description, rebuilt only when revision() changed since the last call
+  auto description() -> const std::string&
+  {
+      const unsigned long current = revision();
+      if(current != m_describedRevision){
+          m_description.clear();   // keeps the capacity, rebuilding does not reallocate
+          describeTo(m_description);
+          m_describedRevision = current;
+      }
+      return m_description;
+  }
+private:
+  std::string   m_description;
+  unsigned long m_describedRevision = ~0ul;
 };
 
 //Concrete shape: Square
@@ -58,10 +168,15 @@ public:
    {
       Log("=> Draw square");
    }
-   auto description() -> std::string 
+   auto compileTo(CommandList& out) -> void
+   {
+      out.drawPrimitive(Primitive::Square);
+   }
+   auto describeTo(std::string& out) -> void
    {
-      return "square";
+      out += "square";
    }
+   auto revision() const -> unsigned long { return 0; }
 };
 
 // Component class 
@@ -72,10 +187,15 @@ public:
     {
        Log(" => Draw tringle"); 
     }
-    auto description() -> std::string
+    auto compileTo(CommandList& out) -> void
     {
-       return "triangle";
+       out.drawPrimitive(Primitive::Triangle);
     }
+    auto describeTo(std::string& out) -> void
+    {
+       out += "triangle";
+    }
+    auto revision() const -> unsigned long { return 0; }
 };
 
 // Decorator 1 => Draw shape with color
@@ -86,24 +206,39 @@ public:
 
     auto draw() -> void
     {
+        TRACE_SCOPE("ColorDecorator::draw");
         // Save color:   push() 
          Log("=> [ColorDecorator] Draw object with color blue");
         m_shape->draw();
         // Restore color: pop()
     }
-    auto description() -> std::string
+    auto compileTo(CommandList& out) -> void
+    {
+        out.pushColor(m_color);
+        m_shape->compileTo(out);
+        out.popColor();
+    }
+    auto describeTo(std::string& out) -> void
     {
-        return  m_shape->description() + " ; color = " + m_color;
+        m_shape->describeTo(out);
+        out += " ; color = ";
+        out += m_color;
+    }
+    auto revision() const -> unsigned long
+    {
+        return m_revision + m_shape->revision();
     }
     // Return a reference to itself (ColorDecorator&)
     auto setColor(const std::string& color) -> decltype(*this)& {
         m_color = color;
+        ++m_revision;
         return *this;
     }
 private:
     // The decorator owns the decorated object 
     std::shared_ptr<IShape>  m_shape;
     std::string   m_color = "blue";
+    unsigned long m_revision = 0;
 };
 
 class PositionDecorator: public IShape {
@@ -113,36 +248,789 @@ public:
 
      auto draw() -> void
      {
+        TRACE_SCOPE("PositionDecorator::draw");
         // Save transformation matrix:   pushMatrix() 
         Log(" =>  [PositionDecorator] Draw object at x = ",m_x," ; y = ",m_y);
         m_shape->draw();
         // Restore transformation matrix: popMatrix()
      }
-     auto description() -> std::string
+     auto compileTo(CommandList& out) -> void
+     {
+        out.pushTransform(m_x, m_y);
+        m_shape->compileTo(out);
+        out.popTransform();
+     }
+     auto describeTo(std::string& out) -> void
      {
-        return  m_shape->description() + " ; position x  = "
-                + std::to_string(m_x) +  " , y = " + std::to_string(m_y);
+        m_shape->describeTo(out);
+        out += " ; position x  = ";
+        appendInt(out, m_x);
+        out += " , y = ";
+        appendInt(out, m_y);
+     }
+     auto revision() const -> unsigned long
+     {
+        return m_revision + m_shape->revision();
      }
 
      auto setPosition(double x, double y) -> PositionDecorator& {
         m_x = x, m_y = y;
+        ++m_revision;
         return *this;
      }  
+     auto x() const -> int { return m_x; }
+     auto y() const -> int { return m_y; }
 private:    
      // The decorator owns the decorated object 
      std::shared_ptr<IShape> m_shape;
      int m_x = 0, m_y = 0;
+     unsigned long m_revision = 0;
+};
+
+// Compile-time decorators (mixins):
+// Instead of wrapping a separately allocated object behind a shared_ptr, a mixin derives
+// from the shape it decorates, e.g. Position<Color<Triangle>>. The whole stack is a single
+// object, and every layer calls the next one with a qualified, non-virtual call (Shape::draw())
+// that the compiler can inline. The only virtual dispatch left is the IShape vtable of the
+// outermost layer, which is the adapter letting the stack be used wherever an IShape is.
+// Layers do not trace or log in draw(): a span and a Log() call per layer cannot be folded
+// away (each one reads the logger state), so the stack is traced once, by Mixin<> below.
+template<class Shape>
+class Color: public Shape {
+public:
+    using Shape::Shape;
+
+    auto draw() -> void
+    {
+        // Save color:   push()
+        Shape::draw();
+        // Restore color: pop()
+    }
+    auto compileTo(CommandList& out) -> void
+    {
+        out.pushColor(m_color);
+        Shape::compileTo(out);
+        out.popColor();
+    }
+    auto describeTo(std::string& out) -> void
+    {
+        Shape::describeTo(out);
+        out += " ; color = ";
+        out += m_color;
+    }
+    auto revision() const -> unsigned long
+    {
+        return m_revision + Shape::revision();
+    }
+    auto setColor(const std::string& color) -> Color& {
+        m_color = color;
+        ++m_revision;
+        return *this;
+    }
+private:
+    std::string m_color = "blue";
+    unsigned long m_revision = 0;
+};
+
+template<class Shape>
+class Position: public Shape {
+public:
+    using Shape::Shape;
+
+    auto draw() -> void
+    {
+        // Save transformation matrix:   pushMatrix()
+        Shape::draw();
+        // Restore transformation matrix: popMatrix()
+    }
+    auto compileTo(CommandList& out) -> void
+    {
+        out.pushTransform(m_x, m_y);
+        Shape::compileTo(out);
+        out.popTransform();
+    }
+    auto describeTo(std::string& out) -> void
+    {
+        Shape::describeTo(out);
+        out += " ; position x  = ";
+        appendInt(out, m_x);
+        out += " , y = ";
+        appendInt(out, m_y);
+    }
+    auto revision() const -> unsigned long
+    {
+        return m_revision + Shape::revision();
+    }
+    auto setPosition(double x, double y) -> Position& {
+        m_x = x, m_y = y;
+        ++m_revision;
+        return *this;
+    }
+private:
+    int m_x = 0, m_y = 0;
+    unsigned long m_revision = 0;
+};
+
+// Outermost layer of a mixin stack: one span and one log line per draw() of the whole stack
+template<class Stack>
+class Mixin final: public Stack {
+public:
+    using Stack::Stack;
+
+    auto draw() -> void
+    {
+        TRACE_SCOPE("Mixin<>::draw");
+        Log("=> [Mixin] Draw object");
+        Stack::draw();
+    }
+};
+
+// Nested<Position, 3, Triangle> => Position<Position<Position<Triangle>>>
+template<template<class> class Layer, int Depth, class Shape>
+struct NestedImpl { using type = Layer<typename NestedImpl<Layer, Depth - 1, Shape>::type>; };
+
+template<template<class> class Layer, class Shape>
+struct NestedImpl<Layer, 0, Shape> { using type = Shape; };
+
+template<template<class> class Layer, int Depth, class Shape>
+using Nested = typename NestedImpl<Layer, Depth, Shape>::type;
+
+// Nanoseconds per draw() of a shape with `Depth` position layers, both forms.
+// The logger is muted meanwhile, so Log() returns right away
+// and the timings show the cost of walking the layers.
+// Each chain layer still opens a span and makes a muted Log() call. A mixin stack makes one
+// of each, in Mixin<>, whatever its depth. At depth 1 both forms do the same work and time
+// the same within noise. Deeper down, the chain grows linearly and the mixin stays flat.
+template<int Depth>
+auto measureDrawCost() -> void
+{
+    constexpr int shapes = 1000, rounds = 200;
+
+    std::vector<std::shared_ptr<IShape>> chains;
+    std::vector<std::shared_ptr<IShape>> mixins;
+    for(int i = 0; i < shapes; ++i){
+        std::shared_ptr<IShape> chain = std::make_shared<Triangle>();
+        for(int d = 0; d < Depth; ++d){ chain = std::make_shared<PositionDecorator>(chain); }
+        chains.push_back(chain);
+        mixins.push_back(std::make_shared<Mixin<Nested<Position, Depth, Triangle>>>());
+    }
+
+    auto measure = [](const std::vector<std::shared_ptr<IShape>>& all){
+        const auto start = std::chrono::steady_clock::now();
+        for(int r = 0; r < rounds; ++r){
+            for(const auto& shape: all){ shape->draw(); }
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / (shapes * rounds);
+    };
+    alog::setMuted(true);
+    const double chainNs = measure(chains);
+    const double mixinNs = measure(mixins);
+    alog::setMuted(false);
+
+    Log(std::setw(8), Depth, std::setw(22), std::fixed, std::setprecision(1), chainNs,
+        std::setw(22), mixinNs);
+}
+
+template<int... Depths>
+auto runDrawBenchmark(std::integer_sequence<int, Depths...>) -> void
+{
+    Log(std::setw(8), "depth", std::setw(22), "shared_ptr [ns/draw]", std::setw(22), "mixin [ns/draw]");
+    (measureDrawCost<Depths + 1>(), ...);
+}
+
+// Allocations and time of description() on a deep chain: first call, repeated calls
+// on the unchanged chain, and calls right after a setPosition() invalidated the cache.
+auto runDescriptionBenchmark(int depth) -> void
+{
+    constexpr int calls = 10000;
+    std::shared_ptr<IShape> shape = std::make_shared<Triangle>();
+    std::vector<std::shared_ptr<PositionDecorator>> layers;
+    for(int d = 0; d < depth; ++d){
+        auto layer = std::make_shared<ColorDecorator>(shape);
+        layer->setColor("red");
+        layers.push_back(std::make_shared<PositionDecorator>(layer));
+        shape = layers.back();
+    }
+
+    auto measure = [&](const char* label, int n, auto&& beforeEachCall){
+        size_t length = 0;
+        const size_t before = alloc::count();
+        const auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < n; ++i){
+            beforeEachCall(i);
+            length += shape->description().size();
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        Log("  ", std::setw(26), label, std::setw(12), std::fixed, std::setprecision(1),
+            elapsed.count() / n, " ns", std::setw(10), double(alloc::count() - before) / n,
+            " allocations/call ; length = ", length / n);
+    };
+    Log("  depth = ", depth * 2, " layers");
+    measure("first call", 1, [](int){ });
+    measure("unchanged chain", calls, [](int){ });
+    measure("after innermost change", calls, [&](int i){ layers.front()->setPosition(i, i); });
+}
+
+// Batched renderer:
+// submit() resolves the color and transform stacks of a compiled command stream into
+// self-contained draw items sorted by state (color, then primitive); render() draws them
+// in one pass, changing the color only when it actually changes, instead of walking
+// every decorator chain recursively. Each submit() rebuilds the items from the current
+// command list, so submitting again after the list changed does not duplicate them.
+class BatchRenderer
+{
+public:
+    struct DrawItem
+    {
+        std::uint32_t color;
+        Primitive     primitive;
+        int           x, y;
+    };
+
+    explicit BatchRenderer(const CommandList& commands): m_commands(commands) { }
+
+    auto submit() -> void
+    {
+        m_items.clear();
+        std::vector<std::uint32_t> colors;
+        std::vector<std::pair<int, int>> transforms{{0, 0}};
+        for(const auto& c: m_commands.commands()){
+            switch(c.op){
+            case DrawOp::PushColor:     colors.push_back(c.arg); break;
+            case DrawOp::PopColor:      colors.pop_back(); break;
+            case DrawOp::PushTransform:
+                transforms.push_back({transforms.back().first + c.x, transforms.back().second + c.y});
+                break;
+            case DrawOp::PopTransform:  transforms.pop_back(); break;
+            case DrawOp::DrawPrimitive:
+                m_items.push_back({colors.empty() ? NoColor : colors.back(),
+                                   static_cast<Primitive>(c.arg),
+                                   transforms.back().first, transforms.back().second});
+                break;
+            }
+        }
+        std::sort(m_items.begin(), m_items.end(), [](const DrawItem& a, const DrawItem& b){
+            return std::tie(a.color, a.primitive) < std::tie(b.color, b.primitive);
+        });
+    }
+
+    // Returns the number of color changes
+    auto render() const -> size_t
+    {
+        size_t stateChanges = 0;
+        std::uint32_t current = NoColor;
+        for(const auto& item: m_items){
+            if(item.color != current){
+                current = item.color;
+                ++stateChanges;
+                if(current != NoColor){ Log("=> [Batch] Set color ", m_commands.colorName(current)); }
+            }
+            Log(" => [Batch] Draw ", item.primitive == Primitive::Square ? "square" : "triangle",
+                " at x = ", item.x, " ; y = ", item.y);
+        }
+        return stateChanges;
+    }
+
+    auto size() const -> size_t { return m_items.size(); }
+private:
+    static constexpr std::uint32_t NoColor = ~0u;
+    const CommandList&    m_commands;
+    std::vector<DrawItem> m_items;
+};
+
+// Frame time of the recursive draw() walk against the compiled, sorted batch
+auto runBatchBenchmark(int count) -> void
+{
+    const char* colors[] = {"red", "green", "blue", "white"};
+    std::vector<std::shared_ptr<IShape>> scene;
+    for(int i = 0; i < count; ++i){
+        std::shared_ptr<IShape> shape;
+        if(i % 2){ shape = std::make_shared<Square>(); } else { shape = std::make_shared<Triangle>(); }
+        auto colored = std::make_shared<ColorDecorator>(shape);
+        colored->setColor(colors[(i * 7) % 4]);
+        auto positioned = std::make_shared<PositionDecorator>(colored);
+        positioned->setPosition(i % 1000, i / 1000);
+        scene.push_back(positioned);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    alog::setMuted(true); // both renderers log, neither writes
+    auto start = Clock::now();
+    for(const auto& shape: scene){ shape->draw(); }
+    const std::chrono::duration<double, std::milli> recursive = Clock::now() - start;
+
+    start = Clock::now();
+    CommandList commands;
+    for(const auto& shape: scene){ shape->compileTo(commands); }
+    BatchRenderer batch{commands};
+    batch.submit();
+    const std::chrono::duration<double, std::milli> compile = Clock::now() - start;
+
+    start = Clock::now();
+    const size_t stateChanges = batch.render();
+    const std::chrono::duration<double, std::milli> batched = Clock::now() - start;
+    alog::setMuted(false);
+
+    Log("  shapes = ", count, " ; commands = ", commands.commands().size(),
+        " ; color changes per frame = ", stateChanges);
+    Log("  recursive frame = ", std::fixed, std::setprecision(2), recursive.count(), " ms",
+        " ; batched frame = ", batched.count(), " ms",
+        " ; one-off compile + sort = ", compile.count(), " ms");
+}
+
+// Shapes allocated from a std::pmr memory resource instead of one heap block per layer.
+// allocate_shared puts the control block and the shape in a single block of the resource;
+// the shapes are still std::shared_ptr<IShape>, so existing code taking one accepts them.
+//   ShapeArena => monotonic buffer: the layers of a chain built one after the other are
+//                 contiguous, deallocation does nothing and the memory is released in bulk
+//                 when the factory goes away.
+//   ShapePool  => pool resource: a freed block is reused by the next shape of the same size,
+//                 for shapes created and destroyed all the time.
+// The factory must outlive the shapes it made. Neither resource is thread-safe.
+template<class Resource>
+class ShapeFactory
+{
+public:
+    explicit ShapeFactory(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : m_resource(upstream) { }
+    ShapeFactory(const ShapeFactory&) = delete;
+    auto operator=(const ShapeFactory&) -> ShapeFactory& = delete;
+
+    template<class Shape, class... Args>
+    auto make(Args&&... args) -> std::shared_ptr<Shape>
+    {
+        return std::allocate_shared<Shape>(std::pmr::polymorphic_allocator<Shape>{&m_resource},
+                                           std::forward<Args>(args)...);
+    }
+
+    // For pmr containers of shapes, or any other pmr-aware code
+    auto resource() -> std::pmr::memory_resource* { return &m_resource; }
+private:
+    Resource m_resource;
+};
+
+using ShapeArena = ShapeFactory<std::pmr::monotonic_buffer_resource>;
+using ShapePool  = ShapeFactory<std::pmr::unsynchronized_pool_resource>;
+
+// Baseline with the factory interface: one make_shared per layer
+struct HeapFactory
+{
+    template<class Shape, class... Args>
+    auto make(Args&&... args) -> std::shared_ptr<Shape>
+    {
+        return std::make_shared<Shape>(std::forward<Args>(args)...);
+    }
+};
+
+// Hardware cache misses of this thread, when the kernel exposes the counter
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.size           = sizeof(attr);
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if(m_fd >= 0){ close(m_fd); }
+#endif
+    }
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    auto operator=(const CacheMissCounter&) -> CacheMissCounter& = delete;
+
+    auto available() const -> bool { return m_fd >= 0; }
+    auto read() const -> long long
+    {
+        long long misses = 0;
+#ifdef __linux__
+        if(m_fd >= 0 && ::read(m_fd, &misses, sizeof(misses)) != sizeof(misses)){ misses = 0; }
+#endif
+        return misses;
+    }
+private:
+    int m_fd = -1;
+};
+
+template<class Factory>
+auto makeChain(Factory& factory, int i) -> std::shared_ptr<IShape>
+{
+    std::shared_ptr<IShape> shape;
+    if(i % 2){ shape = factory.template make<Square>(); } else { shape = factory.template make<Triangle>(); }
+    auto colored = factory.template make<ColorDecorator>(shape);
+    colored->setColor("red");
+    auto positioned = factory.template make<PositionDecorator>(colored);
+    positioned->setPosition(i % 1000, i / 1000);
+    return positioned;
+}
+
+// Build, draw, churn (replace every chain) and destroy `count` chains of 3 layers
+template<class Factory>
+auto measureAllocation(const char* label, int count) -> void
+{
+    using Clock = std::chrono::steady_clock;
+    using Ms    = std::chrono::duration<double, std::milli>;
+    const CacheMissCounter misses;
+    std::vector<std::shared_ptr<IShape>> scene;
+    scene.reserve(count);
+    std::optional<Factory> factory{std::in_place};
+
+    const size_t allocationsBefore = alloc::count();
+    auto start = Clock::now();
+    for(int i = 0; i < count; ++i){ scene.push_back(makeChain(*factory, i)); }
+    const Ms build = Clock::now() - start;
+    const double allocations = double(alloc::count() - allocationsBefore) / count;
+
+    alog::setMuted(true);
+    const long long missesBefore = misses.read();
+    start = Clock::now();
+    for(const auto& shape: scene){ shape->draw(); }
+    const Ms draw = Clock::now() - start;
+    const long long drawMisses = misses.read() - missesBefore;
+    alog::setMuted(false);
+
+    start = Clock::now();
+    for(int i = 0; i < count; ++i){ scene[i] = makeChain(*factory, i); }
+    const Ms churn = Clock::now() - start;
+
+    start = Clock::now();
+    scene.clear();
+    factory.reset();
+    const Ms destroy = Clock::now() - start;
+
+    Log(std::setw(12), label, std::fixed, std::setprecision(1),
+        std::setw(12), count / build.count() / 1e3, std::setw(12), count / destroy.count() / 1e3,
+        std::setw(12), count / churn.count() / 1e3, std::setw(12), draw.count() * 1e6 / count,
+        std::setw(14), misses.available() ? std::to_string(double(drawMisses) / count) : std::string("n/a"),
+        std::setw(14), allocations);
+}
+
+auto runAllocationBenchmark(int count) -> void
+{
+    Log("  ", count, " chains of 3 layers ; throughput in M chains/s");
+    Log(std::setw(12), "factory", std::setw(12), "build", std::setw(12), "destroy",
+        std::setw(12), "churn", std::setw(12), "ns/draw", std::setw(14), "misses/draw",
+        std::setw(14), "allocs/chain");
+    measureAllocation<HeapFactory>("make_shared", count);
+    measureAllocation<ShapeArena>("arena", count);
+    measureAllocation<ShapePool>("pool", count);
+}
+
+//------- Structure-of-arrays shape store -------//
+// Bulk transforms over contiguous coordinates: x[i], y[i] for i < n
+struct TransformKernels
+{
+    const char* name;
+    void (*translate)(float* x, float* y, size_t n, float dx, float dy);
+    void (*scale)(float* x, float* y, size_t n, float sx, float sy);
+    void (*rotate)(float* x, float* y, size_t n, float cosA, float sinA);
 };
 
-int main(){
+inline auto translateScalar(float* x, float* y, size_t n, float dx, float dy) -> void
+{
+    for(size_t i = 0; i < n; ++i){ x[i] += dx; y[i] += dy; }
+}
+inline auto scaleScalar(float* x, float* y, size_t n, float sx, float sy) -> void
+{
+    for(size_t i = 0; i < n; ++i){ x[i] *= sx; y[i] *= sy; }
+}
+inline auto rotateScalar(float* x, float* y, size_t n, float cosA, float sinA) -> void
+{
+    for(size_t i = 0; i < n; ++i){
+        const float px = x[i], py = y[i];
+        x[i] = cosA * px - sinA * py;
+        y[i] = sinA * px + cosA * py;
+    }
+}
+const TransformKernels scalarKernels{"scalar", translateScalar, scaleScalar, rotateScalar};
+
+#if defined(__x86_64__)
+// SSE2 is part of x86-64, AVX2 is checked at run time. No FMA: every kernel rounds
+// exactly like the scalar one, so the paths give bit-identical results.
+inline auto translateSse(float* x, float* y, size_t n, float dx, float dy) -> void
+{
+    const __m128 vdx = _mm_set1_ps(dx), vdy = _mm_set1_ps(dy);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), vdx));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), vdy));
+    }
+    translateScalar(x + i, y + i, n - i, dx, dy);
+}
+inline auto scaleSse(float* x, float* y, size_t n, float sx, float sy) -> void
+{
+    const __m128 vsx = _mm_set1_ps(sx), vsy = _mm_set1_ps(sy);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), vsx));
+        _mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(y + i), vsy));
+    }
+    scaleScalar(x + i, y + i, n - i, sx, sy);
+}
+inline auto rotateSse(float* x, float* y, size_t n, float cosA, float sinA) -> void
+{
+    const __m128 vc = _mm_set1_ps(cosA), vs = _mm_set1_ps(sinA);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        const __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i);
+        _mm_storeu_ps(x + i, _mm_sub_ps(_mm_mul_ps(vc, px), _mm_mul_ps(vs, py)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_mul_ps(vs, px), _mm_mul_ps(vc, py)));
+    }
+    rotateScalar(x + i, y + i, n - i, cosA, sinA);
+}
+const TransformKernels sseKernels{"sse2", translateSse, scaleSse, rotateSse};
 
-    std::puts("\n ======>> Experiment 1 <<===========");
+[[gnu::target("avx2")]] inline auto translateAvx2(float* x, float* y, size_t n, float dx, float dy) -> void
+{
+    const __m256 vdx = _mm256_set1_ps(dx), vdy = _mm256_set1_ps(dy);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), vdx));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), vdy));
+    }
+    translateScalar(x + i, y + i, n - i, dx, dy);
+}
+[[gnu::target("avx2")]] inline auto scaleAvx2(float* x, float* y, size_t n, float sx, float sy) -> void
+{
+    const __m256 vsx = _mm256_set1_ps(sx), vsy = _mm256_set1_ps(sy);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), vsx));
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), vsy));
+    }
+    scaleScalar(x + i, y + i, n - i, sx, sy);
+}
+[[gnu::target("avx2")]] inline auto rotateAvx2(float* x, float* y, size_t n, float cosA, float sinA) -> void
+{
+    const __m256 vc = _mm256_set1_ps(cosA), vs = _mm256_set1_ps(sinA);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        const __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i);
+        _mm256_storeu_ps(x + i, _mm256_sub_ps(_mm256_mul_ps(vc, px), _mm256_mul_ps(vs, py)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_mul_ps(vs, px), _mm256_mul_ps(vc, py)));
+    }
+    rotateScalar(x + i, y + i, n - i, cosA, sinA);
+}
+const TransformKernels avx2Kernels{"avx2", translateAvx2, scaleAvx2, rotateAvx2};
+#endif
+
+// Widest kernels this machine runs
+inline auto bestKernels() -> const TransformKernels&
+{
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")){ return avx2Kernels; }
+    return sseKernels;
+#else
+    return scalarKernels;
+#endif
+}
+
+class ShapeStore;
+
+// Per-shape IShape view of one entry of a ShapeStore, usable with the decorators
+class StoredShape: public IShape
+{
+public:
+    StoredShape(ShapeStore& store, size_t index): m_store(store), m_index(index) { }
+
+    auto draw() -> void;
+    auto compileTo(CommandList& out) -> void;
+    auto describeTo(std::string& out) -> void;
+    auto revision() const -> unsigned long;
+    auto setPosition(double x, double y) -> StoredShape&;
+private:
+    ShapeStore& m_store;
+    size_t      m_index;
+};
+
+// Shapes kept as parallel arrays (positions, color ids, kinds) instead of one object each,
+// so that a transform of every shape is a single pass of vector instructions.
+// Colors are interned, like in CommandList. Positions are floats.
+class ShapeStore
+{
+public:
+    explicit ShapeStore(const TransformKernels& kernels = bestKernels()): m_kernels(&kernels) { }
+
+    auto add(Primitive kind, const std::string& color, float x, float y) -> size_t
+    {
+        m_x.push_back(x);
+        m_y.push_back(y);
+        m_color.push_back(colorId(color));
+        m_kind.push_back(kind);
+        return m_x.size() - 1;
+    }
+    auto reserve(size_t n) -> void
+    {
+        m_x.reserve(n); m_y.reserve(n); m_color.reserve(n); m_kind.reserve(n);
+    }
+
+    auto translate(float dx, float dy) -> void
+    {
+        m_kernels->translate(m_x.data(), m_y.data(), m_x.size(), dx, dy);
+        ++m_revision;
+    }
+    auto scale(float sx, float sy) -> void
+    {
+        m_kernels->scale(m_x.data(), m_y.data(), m_x.size(), sx, sy);
+        ++m_revision;
+    }
+    // Counterclockwise, around the origin
+    auto rotate(float radians) -> void
+    {
+        m_kernels->rotate(m_x.data(), m_y.data(), m_x.size(), std::cos(radians), std::sin(radians));
+        ++m_revision;
+    }
+
+    auto shape(size_t i) -> std::shared_ptr<StoredShape> { return std::make_shared<StoredShape>(*this, i); }
+
+    auto size() const -> size_t { return m_x.size(); }
+    auto x(size_t i) const -> float { return m_x[i]; }
+    auto y(size_t i) const -> float { return m_y[i]; }
+    auto kind(size_t i) const -> Primitive { return m_kind[i]; }
+    auto color(size_t i) const -> const std::string& { return m_palette[m_color[i]]; }
+    auto kernels() const -> const TransformKernels& { return *m_kernels; }
+    auto revision() const -> unsigned long { return m_revision; }
+
+    auto setPosition(size_t i, float x, float y) -> void
+    {
+        m_x[i] = x, m_y[i] = y;
+        ++m_revision;
+    }
+private:
+    auto colorId(const std::string& color) -> std::uint32_t
+    {
+        for(std::uint32_t i = 0; i < m_palette.size(); ++i){
+            if(m_palette[i] == color){ return i; }
+        }
+        m_palette.push_back(color);
+        return static_cast<std::uint32_t>(m_palette.size() - 1);
+    }
+
+    const TransformKernels*    m_kernels;
+    std::vector<float>         m_x, m_y;
+    std::vector<std::uint32_t> m_color;
+    std::vector<Primitive>     m_kind;
+    std::vector<std::string>   m_palette;
+    unsigned long              m_revision = 0;
+};
+
+auto StoredShape::draw() -> void
+{
+    Log(" =>  [ShapeStore] Draw ", m_store.kind(m_index) == Primitive::Square ? "square" : "triangle",
+        " with color ", m_store.color(m_index),
+        " at x = ", m_store.x(m_index), " ; y = ", m_store.y(m_index));
+}
+auto StoredShape::compileTo(CommandList& out) -> void
+{
+    out.pushColor(m_store.color(m_index));
+    out.pushTransform(static_cast<int>(m_store.x(m_index)), static_cast<int>(m_store.y(m_index)));
+    out.drawPrimitive(m_store.kind(m_index));
+    out.popTransform();
+    out.popColor();
+}
+auto StoredShape::describeTo(std::string& out) -> void
+{
+    out += m_store.kind(m_index) == Primitive::Square ? "square" : "triangle";
+    out += " ; color = ";
+    out += m_store.color(m_index);
+    out += " ; position x  = ";
+    appendInt(out, static_cast<int>(m_store.x(m_index)));
+    out += " , y = ";
+    appendInt(out, static_cast<int>(m_store.y(m_index)));
+}
+auto StoredShape::revision() const -> unsigned long { return m_store.revision(); }
+auto StoredShape::setPosition(double x, double y) -> StoredShape&
+{
+    m_store.setPosition(m_index, static_cast<float>(x), static_cast<float>(y));
+    return *this;
+}
+
+// One translate + scale + rotate pass over `count` shapes: position decorators updated one
+// at a time through setPosition(), against the store with each available kernel set
+auto runTransformBenchmark(int count) -> void
+{
+    using Clock = std::chrono::steady_clock;
+    using Ms    = std::chrono::duration<double, std::milli>;
+    const float angle = 0.01f, cosA = std::cos(angle), sinA = std::sin(angle);
+
+    double decoratorMs = 0;
+    {
+        ShapeArena arena;
+        const std::shared_ptr<IShape> triangle = arena.make<Triangle>();
+        std::vector<std::shared_ptr<PositionDecorator>> shapes;
+        shapes.reserve(count);
+        for(int i = 0; i < count; ++i){
+            shapes.push_back(arena.make<PositionDecorator>(triangle));
+            shapes.back()->setPosition(i % 1000, i / 1000);
+        }
+        const auto start = Clock::now();
+        for(const auto& s: shapes){ s->setPosition(s->x() + 3, s->y() - 2); }
+        for(const auto& s: shapes){ s->setPosition(s->x() * 2, s->y() * 2); }
+        for(const auto& s: shapes){
+            s->setPosition(cosA * s->x() - sinA * s->y(), sinA * s->x() + cosA * s->y());
+        }
+        decoratorMs = Ms(Clock::now() - start).count();
+        shapes.clear();
+    }
+    Log("  ", count, " shapes ; translate + scale + rotate");
+    Log(std::setw(16), "decorators", std::fixed, std::setprecision(2),
+        std::setw(12), decoratorMs, " ms", std::setw(10), decoratorMs * 1e6 / count, " ns/shape");
+
+    std::vector<const TransformKernels*> kernelSets{&scalarKernels};
+#if defined(__x86_64__)
+    kernelSets.push_back(&sseKernels);
+    if(__builtin_cpu_supports("avx2")){ kernelSets.push_back(&avx2Kernels); }
+#endif
+    std::vector<float> reference;
+    for(const TransformKernels* kernels: kernelSets){
+        ShapeStore store{*kernels};
+        store.reserve(count);
+        for(int i = 0; i < count; ++i){
+            store.add(i % 2 ? Primitive::Square : Primitive::Triangle, "red", i % 1000, i / 1000);
+        }
+        const auto start = Clock::now();
+        store.translate(3, -2);
+        store.scale(2, 2);
+        store.rotate(angle);
+        const double storeMs = Ms(Clock::now() - start).count();
+
+        // Every kernel set must give the scalar results, bit for bit
+        bool same = true;
+        if(reference.empty()){
+            for(int i = 0; i < count; ++i){ reference.push_back(store.x(i)); reference.push_back(store.y(i)); }
+        } else {
+            for(int i = 0; i < count && same; ++i){
+                same = std::bit_cast<std::uint32_t>(reference[2 * i]) == std::bit_cast<std::uint32_t>(store.x(i))
+                    && std::bit_cast<std::uint32_t>(reference[2 * i + 1]) == std::bit_cast<std::uint32_t>(store.y(i));
+            }
+        }
+        Log(std::setw(16), std::string("store ") + kernels->name,
+            std::setw(12), storeMs, " ms", std::setw(10), storeMs * 1e6 / count, " ns/shape",
+            std::setw(10), decoratorMs / storeMs, "x", same ? "" : "  MISMATCH with scalar");
+    }
+}
+
+int main(int argc, char** argv){
+    // --trace=FILE records the draw() chains of experiments 1 to 3 as spans
+    const auto traceFile = trace::fileFromArgs(argc, argv);
+    trace::setEnabled(traceFile.has_value());
+
+    Log("\n ======>> Experiment 1 <<===========");
     auto shape = std::make_shared<ColorDecorator>(std::make_shared<Square>());
     shape->setColor("yellow");
     shape->draw();
     Log(shape->description());
 
-    std::puts("\n ======>> Experiment 2 <<===========");
+    Log("\n ======>> Experiment 2 <<===========");
     auto observerd = std::shared_ptr<IShape>{nullptr};
 
     auto shapeWithColorAndPosition =
@@ -161,5 +1049,61 @@ int main(){
     Log("DESCRIPTION = ",shapeWithColorAndPosition->description());
     Log("[INFO] observed shape = ",observerd->description());
 
+    Log("\n ======>> Experiment 3 <<===========");
+    // Same shape as experiment 2, as a single object with inlined layers
+    auto mixinShape = std::make_shared<Mixin<Position<Color<Triangle>>>>();
+    mixinShape->setColor("white");
+    mixinShape->setPosition(100, 20);
+    std::shared_ptr<IShape> asInterface = mixinShape;
+    asInterface->draw();
+    Log("DESCRIPTION = ",asInterface->description());
+    trace::setEnabled(false);
+    if(traceFile){
+        const bool saved = trace::save(*traceFile);
+        Log(saved ? "Trace written to " : "Cannot write the trace to ", *traceFile);
+    }
+
+    Log("\n ======>> Experiment 4 <<===========");
+    runDrawBenchmark(std::make_integer_sequence<int, 16>{});
+
+    Log("\n ======>> Experiment 5 <<===========");
+    runDescriptionBenchmark(8);
+    runDescriptionBenchmark(32);
+
+    Log("\n ======>> Experiment 6 <<===========");
+    // Compile the shapes of experiments 1 to 3 into one command stream and draw them batched
+    CommandList commands;
+    shape->compileTo(commands);
+    shapeWithColorAndPosition->compileTo(commands);
+    mixinShape->compileTo(commands);
+    BatchRenderer renderer{commands};
+    renderer.submit();
+    renderer.render();
+    runBatchBenchmark(100000);
+
+    Log("\n ======>> Experiment 7 <<===========");
+    // The chain of experiment 2 built in an arena, used like any other shape
+    ShapeArena arena;
+    auto arenaShape = arena.make<PositionDecorator>(arena.make<ColorDecorator>(arena.make<Triangle>()));
+    arenaShape->setPosition(100, 20);
+    arenaShape->draw();
+    Log("DESCRIPTION = ", arenaShape->description());
+    runAllocationBenchmark(1000000);
+
+    Log("\n ======>> Experiment 8 <<===========");
+    // Shapes of a structure-of-arrays store, transformed in bulk and viewed as IShape
+    ShapeStore store;
+    store.add(Primitive::Triangle, "white", 100, 20);
+    store.add(Primitive::Square, "yellow", 0, 0);
+    store.translate(10, 10);
+    store.scale(0.5f, 0.5f);
+    for(size_t i = 0; i < store.size(); ++i){
+        std::shared_ptr<IShape> view = store.shape(i);
+        view->draw();
+        Log("DESCRIPTION = ", view->description());
+    }
+    Log("  kernels = ", store.kernels().name);
+    runTransformBenchmark(10000000);
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+// Epoch-based reclamation
+/*
+    Lets readers use objects published through an atomic pointer without locks or
+    reference counts, while writers replace them:
+
+        const List* list;
+        {
+            epoch::Guard guard;                 // reader: a few stores and loads, wait-free
+            list = current.load();
+            ... use *list ...
+        }
+        epoch::retire(current.exchange(next));  // writer: deleted once no reader can hold it
+
+    A reader announces the global epoch it observed in its slot for the duration of a
+    critical section (Guard). An object removed from a shared pointer is retired with the
+    current epoch, and deleted once the epoch advanced twice: the epoch only advances when
+    every reader inside a critical section announced the current one, so after two advances
+    no reader can still hold the object.
+
+    Guards nest: only the outermost guard of a thread announces and clears its slot.
+    Retired objects are freed on the writer side only, by retire() and synchronize(), so
+    a guard never takes a lock or runs a destructor. synchronize() frees everything
+    retired so far, waiting for the readers that may still hold it.
+
+    Slots come in blocks of SlotsPerBlock; when every slot is in use, the thread claiming
+    one appends a new block. Blocks live as long as the domain.
+*/
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <cassert>
+
+namespace epoch {
+
+class Domain
+{
+    static constexpr std::uint64_t Idle = 0;
+
+    struct alignas(64) Slot
+    {
+        std::atomic<std::uint64_t> epoch{Idle};
+        std::atomic<bool>          used{false};
+        unsigned                   depth{0}; // guards of the owning thread, only it reads it
+    };
+public:
+    static constexpr size_t SlotsPerBlock = 64;
+
+    static auto instance() -> Domain&
+    {
+        static Domain domain;
+        return domain;
+    }
+
+    Domain(const Domain&) = delete;
+    Domain& operator=(const Domain&) = delete;
+
+    class Guard
+    {
+    public:
+        Guard(): m_domain(Domain::instance()), m_slot(m_domain.slotOfThisThread())
+        {
+            if(m_slot.depth++ == 0){
+                m_slot.epoch.store(m_domain.m_global.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+            }
+        }
+
+        ~Guard()
+        {
+            if(--m_slot.depth == 0){ m_slot.epoch.store(Idle, std::memory_order_release); }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    private:
+        Domain& m_domain;
+        Slot&   m_slot;
+    };
+
+    /** Delete the object once no reader can hold it any more */
+    template<typename T>
+    auto retire(const T* object) -> void
+    {
+        if(object == nullptr){ return; }
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_retired.push_back({m_global.load(std::memory_order_seq_cst), object,
+                             [](const void* p){ delete static_cast<const T*>(p); }});
+        m_pending.store(m_retired.size(), std::memory_order_relaxed);
+        reclaimLocked();
+    }
+
+    /** Delete everything retired so far; must not be called inside a critical section */
+    auto synchronize() -> void
+    {
+        const std::uint64_t target = m_global.load(std::memory_order_seq_cst) + 2;
+        for(;;){
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                reclaimLocked();
+                if(m_global.load(std::memory_order_relaxed) >= target){ return; }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /** Objects retired and not deleted yet */
+    auto pending() const -> size_t { return m_pending.load(std::memory_order_relaxed); }
+
+private:
+    struct Retired
+    {
+        std::uint64_t epoch;
+        const void*   object;
+        void        (*destroy)(const void*);
+    };
+
+    struct Block
+    {
+        Slot                slots[SlotsPerBlock];
+        std::atomic<Block*> next{nullptr};
+    };
+
+    Domain() = default;
+
+    ~Domain()
+    {
+        for(const auto& r: m_retired){ r.destroy(r.object); }
+        for(Block* block = m_first.next.load(std::memory_order_acquire); block != nullptr;){
+            Block* next = block->next.load(std::memory_order_acquire);
+            delete block;
+            block = next;
+        }
+    }
+
+    // Claimed on the first Guard of a thread, released when the thread exits
+    auto slotOfThisThread() -> Slot&
+    {
+        struct Registration
+        {
+            Slot* slot = nullptr;
+            ~Registration()
+            {
+                if(slot){
+                    assert(slot->depth == 0);
+                    slot->used.store(false, std::memory_order_release);
+                }
+            }
+        };
+        thread_local Registration registration;
+        for(Block* block = &m_first; registration.slot == nullptr;){
+            for(auto& s: block->slots){
+                bool expected = false;
+                if(s.used.compare_exchange_strong(expected, true, std::memory_order_acq_rel)){
+                    registration.slot = &s;
+                    break;
+                }
+            }
+            if(registration.slot != nullptr){ break; }
+            // Every slot of this block is in use: move to the next one, appending it if needed.
+            // seq_cst, so a reclaimer that misses the new block treats it like an unused slot
+            Block* next = block->next.load(std::memory_order_seq_cst);
+            if(next == nullptr){
+                Block* fresh = new Block;
+                if(block->next.compare_exchange_strong(next, fresh, std::memory_order_seq_cst)){ next = fresh; }
+                else{ delete fresh; }
+            }
+            block = next;
+        }
+        return *registration.slot;
+    }
+
+    // Advance the epoch if every reader caught up, then delete what became unreachable
+    auto reclaimLocked() -> void
+    {
+        const std::uint64_t current = m_global.load(std::memory_order_seq_cst);
+        bool advance = true;
+        for(const Block* block = &m_first; block != nullptr && advance;
+            block = block->next.load(std::memory_order_seq_cst)){
+            for(const auto& s: block->slots){
+                const std::uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+                if(e != Idle && e != current){ advance = false; break; }
+            }
+        }
+        if(advance){
+            std::uint64_t expected = current;
+            m_global.compare_exchange_strong(expected, current + 1, std::memory_order_seq_cst);
+        }
+        const std::uint64_t now = m_global.load(std::memory_order_relaxed);
+        std::erase_if(m_retired, [now](const Retired& r){
+            if(r.epoch + 2 > now){ return false; }
+            r.destroy(r.object);
+            return true;
+        });
+        m_pending.store(m_retired.size(), std::memory_order_relaxed);
+    }
+
+    std::atomic<std::uint64_t> m_global{1};
+    std::atomic<size_t>        m_pending{0};
+    Block                      m_first;
+    std::mutex                 m_mutex;
+    std::vector<Retired>       m_retired;
+};
+
+using Guard = Domain::Guard;
+
+template<typename T>
+inline auto retire(const T* object) -> void { Domain::instance().retire(object); }
+
+inline auto synchronize() -> void { Domain::instance().synchronize(); }
+
+} // namespace epoch
@@ -0,0 +1,445 @@
+// Observer-Observable with asynchronous dispatch
+/*
+    In ObserverCallback.cpp every observer is called synchronously from Observable::notify(),
+    so an observer that blocks stalls the subject and every observer after it.
+
+    This variant gives each subscription its own bounded lock-free queue.
+    The subject only pushes the new value into the queue of every subscription and returns;
+    the callbacks run later on an executor, which can be either:
+        ThreadPoolExecutor => a fixed set of worker threads.
+        EventLoopExecutor  => a loop driven by the caller, e.g. the GUI thread, via runPending().
+
+    A subscription is drained by at most one executor task at a time, so callbacks of the
+    same subscription never run concurrently and see the values in order.
+
+    When a subscription queue is full the overflow policy decides what happens:
+        DropOldest       => discard the oldest queued value to make room for the new one.
+        CoalesceToLatest => collapse every pending value into the newest one.
+        Block            => the notifying thread waits until the observer has made room.
+                            Never use it with an EventLoopExecutor driven by the notifying thread.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+/** Bounded multi-producer/multi-consumer lock-free queue (Dmitry Vyukov's algorithm).
+    Every cell carries a sequence number telling whether it is ready to be written or read,
+    so producers and consumers only contend on their own position counter.
+*/
+template<typename T>
+class BoundedQueue
+{
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T                   value;
+    };
+
+    std::vector<Cell>   m_cells;
+    const size_t        m_mask;
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) std::atomic<size_t> m_dequeuePos{0};
+
+    static size_t roundUpToPowerOfTwo(size_t n)
+    {
+        size_t p = 2;
+        while(p < n){ p <<= 1; }
+        return p;
+    }
+public:
+
+    explicit BoundedQueue(size_t capacity)
+        : m_cells(roundUpToPowerOfTwo(capacity)), m_mask(m_cells.size() - 1)
+    {
+        for(size_t i = 0; i < m_cells.size(); ++i){
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPush(const T& value)
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for(;;){
+            Cell& cell = m_cells[pos & m_mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff  = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if(diff == 0){
+                if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if(diff < 0){
+                return false; // full
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value)
+    {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for(;;){
+            Cell& cell = m_cells[pos & m_mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff  = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if(diff == 0){
+                if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                    value = cell.value;
+                    cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if(diff < 0){
+                return false; // empty
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Approximate: a push in progress already counts as an element */
+    bool empty() const
+    {
+        return m_enqueuePos.load() == m_dequeuePos.load();
+    }
+};
+
+//---------------- Executors -------------------//
+
+struct IExecutor
+{
+    /** Run the task at some later point, on some executor-owned thread */
+    virtual void post(std::function<void ()> task) = 0;
+
+    virtual     ~IExecutor() = default;
+};
+
+/** Fixed pool of worker threads. The destructor runs every queued task before joining. */
+class ThreadPoolExecutor: public IExecutor
+{
+    std::mutex                          m_lock{};
+    std::condition_variable             m_wakeup{};
+    std::deque<std::function<void ()>>  m_tasks{};
+    bool                                m_stopping{false};
+    std::vector<std::thread>            m_workers{};
+
+    void workerLoop()
+    {
+        for(;;){
+            std::function<void ()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_wakeup.wait(lock, [this]{ return m_stopping || !m_tasks.empty(); });
+                if(m_tasks.empty()){ return; }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+public:
+
+    explicit ThreadPoolExecutor(unsigned threads)
+    {
+        for(unsigned i = 0; i < threads; ++i){
+            m_workers.emplace_back([this]{ workerLoop(); });
+        }
+    }
+
+    ~ThreadPoolExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stopping = true;
+        }
+        m_wakeup.notify_all();
+        for(auto& w: m_workers){ w.join(); }
+    }
+
+    void post(std::function<void ()> task) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_tasks.push_back(std::move(task));
+        }
+        m_wakeup.notify_one();
+    }
+};
+
+/** Executor driven by its owner thread, like the event loop of a GUI toolkit */
+class EventLoopExecutor: public IExecutor
+{
+    std::mutex                          m_lock{};
+    std::deque<std::function<void ()>>  m_tasks{};
+public:
+
+    void post(std::function<void ()> task) override
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_tasks.push_back(std::move(task));
+    }
+
+    /** Run the tasks posted so far. Returns the number of tasks executed. */
+    size_t runPending()
+    {
+        std::deque<std::function<void ()>> batch;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            batch.swap(m_tasks);
+        }
+        for(auto& task: batch){ task(); }
+        return batch.size();
+    }
+};
+
+//---------------- Observable -------------------//
+
+enum class OverflowPolicy { DropOldest, CoalesceToLatest, Block };
+
+template<typename T>
+using ValueCallback = std::function<void (const T& value)>;
+
+/** One observer with its private queue, filled by the subject and drained on the executor */
+template<typename T>
+class AsyncSubscription
+{
+    ValueCallback<T>        m_callback;
+    IExecutor&              m_executor;
+    const OverflowPolicy    m_policy;
+    BoundedQueue<T>         m_queue;
+    std::atomic<bool>       m_scheduled{false};
+    std::atomic<size_t>     m_dropped{0};
+
+    void discardOne()
+    {
+        T stale;
+        if(m_queue.tryPop(stale)){ m_dropped.fetch_add(1, std::memory_order_relaxed); }
+    }
+
+    void schedule()
+    {
+        if(!m_scheduled.exchange(true, std::memory_order_acq_rel)){
+            m_executor.post([this]{ drain(); });
+        }
+    }
+
+    void drain()
+    {
+        T value;
+        for(;;){
+            while(m_queue.tryPop(value)){ m_callback(value); }
+            m_scheduled.store(false, std::memory_order_seq_cst);
+            // A value pushed while we were draining may have seen m_scheduled == true
+            // and skipped posting a task, so look again before going idle.
+            if(m_queue.empty() || m_scheduled.exchange(true, std::memory_order_acq_rel)){ return; }
+        }
+    }
+public:
+
+    AsyncSubscription(ValueCallback<T> callback, IExecutor& executor,
+                      OverflowPolicy policy, size_t capacity)
+        : m_callback(std::move(callback)), m_executor(executor),
+          m_policy(policy), m_queue(capacity)
+    { }
+
+    void push(const T& value)
+    {
+        while(!m_queue.tryPush(value)){
+            switch(m_policy){
+            case OverflowPolicy::DropOldest:
+                discardOne();
+                break;
+            case OverflowPolicy::CoalesceToLatest:
+                while(!m_queue.empty()){ discardOne(); }
+                break;
+            case OverflowPolicy::Block:
+                schedule();
+                std::this_thread::yield();
+                break;
+            }
+        }
+        schedule();
+    }
+
+    /** Number of values discarded by the overflow policy */
+    size_t dropped() const { return m_dropped.load(); }
+};
+
+template<typename T>
+class AsyncObservable
+{
+    std::vector<ValueCallback<T>>                       m_syncObservers{};
+    std::vector<std::unique_ptr<AsyncSubscription<T>>>  m_asyncObservers{};
+public:
+
+    /** Subscribe; the callback runs on the notifying thread (same as ObserverCallback.cpp) */
+    void addObserver(ValueCallback<T> callback)
+    {
+        m_syncObservers.push_back(std::move(callback));
+    }
+
+    /** Subscribe; the callback runs on the executor, fed by a queue of `capacity` values */
+    AsyncSubscription<T>& addObserver(ValueCallback<T> callback, IExecutor& executor,
+                                      OverflowPolicy policy, size_t capacity = 64)
+    {
+        m_asyncObservers.push_back(std::make_unique<AsyncSubscription<T>>(
+            std::move(callback), executor, policy, capacity));
+        return *m_asyncObservers.back();
+    }
+
+    /** Notify all observers */
+    void notify(const T& value)
+    {
+        for(const auto& callback: m_syncObservers){ callback(value); }
+        for(const auto& subscription: m_asyncObservers){ subscription->push(value); }
+    }
+};
+
+/** The executors must be destroyed (drained) before the model they deliver for */
+class CounterModel
+{
+    int m_counter{0};
+    AsyncObservable<int> m_obs{};
+public:
+    void increment() { m_counter += 1; m_obs.notify(m_counter); }
+    void decrement() { m_counter -= 1; m_obs.notify(m_counter); }
+    int  get() const { return m_counter; }
+
+    void onCounterChanged(ValueCallback<int> callback)
+    {
+        m_obs.addObserver(std::move(callback));
+    }
+
+    AsyncSubscription<int>& onCounterChanged(ValueCallback<int> callback, IExecutor& executor,
+                                             OverflowPolicy policy, size_t capacity = 64)
+    {
+        return m_obs.addObserver(std::move(callback), executor, policy, capacity);
+    }
+};
+
+/** Stands in for a widget whose repaint is slow */
+class FormView
+{
+    std::chrono::microseconds m_renderTime;
+    std::atomic<int>          m_updates{0};
+    std::atomic<int>          m_shown{0};
+public:
+
+    explicit FormView(std::chrono::microseconds renderTime = std::chrono::microseconds{0})
+        : m_renderTime(renderTime)
+    { }
+
+    void update(int cnt)
+    {
+        std::this_thread::sleep_for(m_renderTime);
+        m_shown.store(cnt);
+        m_updates.fetch_add(1);
+    }
+
+    int updates() const { return m_updates.load(); }
+    int shown()   const { return m_shown.load(); }
+};
+
+/** Mean latency of CounterModel::increment() in microseconds */
+double measureIncrementLatency(CounterModel& model, int increments)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < increments; ++i){ model.increment(); }
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / increments;
+}
+
+/** increment() latency under every dispatch policy, for one FormView render time.
+    Returns the synchronous and the Block latencies. */
+std::pair<double, double> runLatencyBenchmark(std::chrono::microseconds renderTime)
+{
+    constexpr int increments = 200;
+    double synchronous = 0, blocking = 0;
+
+    std::cout << " render time = " << renderTime.count() << " us\n"
+              << std::setw(20) << "dispatch"
+              << std::setw(24) << "increment() [us]"
+              << std::setw(12) << "delivered"
+              << std::setw(12) << "dropped" << '\n';
+
+    {
+        CounterModel model;
+        FormView view{renderTime};
+        model.onCounterChanged([&view](const int& cnt){ view.update(cnt); });
+        synchronous = measureIncrementLatency(model, increments);
+        std::cout << std::setw(20) << "synchronous" << std::setw(24) << synchronous
+                  << std::setw(12) << view.updates() << std::setw(12) << 0 << '\n';
+    }
+
+    const std::pair<const char*, OverflowPolicy> policies[] = {
+        {"drop-oldest",        OverflowPolicy::DropOldest},
+        {"coalesce-to-latest", OverflowPolicy::CoalesceToLatest},
+        {"block",              OverflowPolicy::Block},
+    };
+    for(const auto& [label, policy]: policies){
+        CounterModel model;
+        FormView view{renderTime};
+        double latency = 0;
+        size_t dropped = 0;
+        {
+            ThreadPoolExecutor pool{1};
+            auto& sub = model.onCounterChanged([&view](const int& cnt){ view.update(cnt); },
+                                               pool, policy, 16);
+            latency = measureIncrementLatency(model, increments);
+            dropped = sub.dropped();
+        } // pool drains the remaining queued values here
+        if(policy == OverflowPolicy::Block){ blocking = latency; }
+        std::cout << std::setw(20) << label << std::setw(24) << latency
+                  << std::setw(12) << view.updates() << std::setw(12) << dropped
+                  << "   last shown = " << view.shown() << '\n';
+    }
+    return {synchronous, blocking};
+}
+
+/** The queued policies stay flat while the synchronous path grows with the render time */
+void runLatencyBenchmark()
+{
+    std::pair<double, double> slowest{};
+    for(const int us: {0, 50, 500, 5000}){
+        slowest = runLatencyBenchmark(std::chrono::microseconds{us});
+    }
+    std::cout << std::fixed << std::setprecision(0)
+              << " note: once its queue is full, block waits for the observer like the synchronous path ("
+              << slowest.second << " us against " << slowest.first << " us at 5000 us per render)\n";
+}
+
+int main()
+{
+    CounterModel      model;
+    EventLoopExecutor guiLoop{};
+    FormView          observerB{};
+
+    model.onCounterChanged([](const int& cnt){
+        std::cout << " [CONSOLE VIEW] Counter state changed to = " << cnt << '\n';
+    });
+
+    model.onCounterChanged([&](const int& cnt){
+        std::cout << " [QT GUI] Counter state changed to = " << cnt << '\n';
+        observerB.update(cnt);
+    }, guiLoop, OverflowPolicy::CoalesceToLatest, 2);
+
+    std::cout << " -------------------------------- \n";
+    //Simulate a burst of increments, the GUI only catches up when its loop runs
+    for(int i = 0; i < 5; ++i){ model.increment(); }
+    const size_t tasks = guiLoop.runPending();
+    std::cout << " [EVENT LOOP] tasks run = " << tasks << '\n';
+
+    std::cout << "\n ------ increment() latency with a slow observer ------ \n";
+    runLatencyBenchmark();
+    return EXIT_SUCCESS;
+}
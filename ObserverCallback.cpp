@@ -64,23 +64,121 @@ Pull model. Observer executes Subject.getData() to get data from subject.
 Push model. The subject pass its data as argument of observers' update method. for o in observers do o.update(subject.data)
 */
 
-//Below example uses std::function<> callback which makes the code more loose coupled as any objects from any class and lambdas can be used as observers.
+//Below example uses a std::function<> like callback which makes the code more loose coupled as any objects from any class and lambdas can be used as observers.
+//InplaceCallback stores the callable inside the callback object itself, so subscribing and notifying never touch the heap.
 
 #include <iostream>
 #include <iomanip>
 #include <functional> 
 #include <vector> 
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
+#include <utility>
+#include <cassert>
+
+#include "SlotMap.hpp"
+#include "AllocCounter.hpp"
 
 //include <QtWidgets>
 //#include <QApplication>
 //#include <QSysInfo>
 
-using ObserverCallback = std::function<void (void* sender)>;
+/** Move-only std::function replacement with a fixed inline buffer.
+    The callable is constructed directly inside the object and a callable larger
+    than Capacity is rejected at compile time, so it never allocates.
+*/
+template<class Signature, size_t Capacity = 4 * sizeof(void*)>
+class InplaceCallback;
+
+template<class R, class... Args, size_t Capacity>
+class InplaceCallback<R (Args...), Capacity>
+{
+    using Invoker = R (*)(void* callable, Args&&... args);
+    // Moves the callable from src into dst (when dst is not null) and destroys src
+    using Manager = void (*)(void* dst, void* src) noexcept;
+
+    alignas(std::max_align_t) unsigned char m_storage[Capacity];
+    Invoker m_invoke{nullptr};
+    Manager m_manage{nullptr};
+
+    void reset() noexcept
+    {
+        if(m_manage){ m_manage(nullptr, m_storage); }
+        m_invoke = nullptr;
+        m_manage = nullptr;
+    }
+
+    void moveFrom(InplaceCallback& other) noexcept
+    {
+        if(other.m_manage){ other.m_manage(m_storage, other.m_storage); }
+        m_invoke = other.m_invoke;
+        m_manage = other.m_manage;
+        other.m_invoke = nullptr;
+        other.m_manage = nullptr;
+    }
+public:
+
+    InplaceCallback() = default;
+
+    template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceCallback>>>
+    InplaceCallback(F&& f)
+    {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Capacity, "Callable too large for InplaceCallback, increase Capacity");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "Over-aligned callable");
+        static_assert(std::is_nothrow_move_constructible_v<Fn>, "Callable must be nothrow movable");
+
+        ::new (static_cast<void*>(m_storage)) Fn(std::forward<F>(f));
+        m_invoke = [](void* callable, Args&&... args) -> R {
+            return (*static_cast<Fn*>(callable))(std::forward<Args>(args)...);
+        };
+        m_manage = [](void* dst, void* src) noexcept {
+            if(dst){ ::new (dst) Fn(std::move(*static_cast<Fn*>(src))); }
+            static_cast<Fn*>(src)->~Fn();
+        };
+    }
+
+    InplaceCallback(InplaceCallback&& other) noexcept { moveFrom(other); }
+
+    InplaceCallback& operator=(InplaceCallback&& other) noexcept
+    {
+        if(this != &other){
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceCallback(const InplaceCallback&) = delete;
+    InplaceCallback& operator=(const InplaceCallback&) = delete;
+
+    ~InplaceCallback() { reset(); }
+
+    explicit operator bool() const { return m_invoke != nullptr; }
+
+    // Like std::function, a const callback may still invoke a mutable lambda.
+    // Must not be empty (default-constructed or moved-from): check operator bool first.
+    R operator()(Args... args) const
+    {
+        assert(m_invoke && "calling an empty InplaceCallback");
+        return m_invoke(const_cast<unsigned char*>(m_storage), std::forward<Args>(args)...);
+    }
+};
+
+using ObserverCallback = InplaceCallback<void (void* sender)>;
 
 struct IObservable 
 {
     /** Subscribe to observable notifications */
-    virtual void addObserver(ObserverCallback obs) = 0;
+    virtual Subscription addObserver(ObserverCallback obs) = 0;
+
+    /** Unsubscribe in O(1); a stale handle is ignored and false is returned */
+    virtual bool removeObserver(Subscription handle) = 0;
 
     /** Notify all observers */
     virtual void notify() = 0; 
@@ -91,24 +189,30 @@ struct IObservable
 class Observable: public IObservable 
 {
     void* m_sender{nullptr};
-    std::vector<ObserverCallback> m_observers{};
+    SlotMap<ObserverCallback> m_observers{};
     
 public:
 
     Observable(){ }
     Observable(void* sender): m_sender(sender){ }
     
-    void addObserver(ObserverCallback callback) override 
+    Subscription addObserver(ObserverCallback callback) override 
     {
-        m_observers.push_back(callback);
         std::cout << " Observable calling back the callback \n";
         callback(m_sender);//give the sender info to callback
+        return m_observers.insert(std::move(callback));
+    }
+
+    /** Must not be called from inside a callback */
+    bool removeObserver(Subscription handle) override
+    {
+        return m_observers.erase(handle);
     }
 
     /** Notify all observers */
     void notify() override  
     {
-        for(const auto callback: m_observers){ callback(m_sender); }
+        for(const auto& callback: m_observers){ callback(m_sender); }
     }    
 };
 
@@ -121,9 +225,14 @@ public:
     void decrement() { m_counter -= 1; m_obs.notify(); }
     int  get() const { return m_counter; }
 
-    void onCounterChanged(ObserverCallback callback)
+    Subscription onCounterChanged(ObserverCallback callback)
     {
-        m_obs.addObserver(callback);
+        return m_obs.addObserver(std::move(callback));
+    }
+
+    bool disconnect(Subscription handle)
+    {
+        return m_obs.removeObserver(handle);
     }
 };
 
@@ -194,8 +303,62 @@ public:
 
 };
 
+/** Notifying must not allocate, whatever the observers capture (within Capacity) */
+bool checkNotifyDoesNotAllocate()
+{
+    CounterModel model;
+    long sum = 0;
+    double scale = 2.0;
+    int* counter = nullptr;
+    model.onCounterChanged([&sum](void* sender){ sum += static_cast<CounterModel*>(sender)->get(); });
+    model.onCounterChanged([&sum, &scale, counter](void* sender) mutable {
+        sum += long(scale * static_cast<CounterModel*>(sender)->get()) + (counter != nullptr);
+    });
+
+    const size_t before = alloc::count();
+    for(int i = 0; i < 1000; ++i){ model.increment(); }
+    const size_t allocations = alloc::count() - before;
+
+    std::cout << " [ALLOC] allocations during 1000 notifications = " << allocations
+              << " ; result = " << (allocations == 0 ? "PASS" : "FAIL") << '\n';
+    return allocations == 0;
+}
 
-int main(int argc, char** argv)
+/** Notification cost of the former std::function path (iterated by copy) and of InplaceCallback */
+void runCallbackBenchmark()
+{
+    constexpr int notifications = 1 << 20, observers = 8;
+    long sum = 0, a = 1, b = 2;
+    void* sender = &sum;
+
+    std::vector<std::function<void (void*)>> legacy;
+    Observable current{sender};
+    for(int i = 0; i < observers; ++i){
+        legacy.emplace_back([&sum, &a, &b](void*){ sum += a + b; });
+        current.addObserver([&sum, &a, &b](void*){ sum += a + b; });
+    }
+
+    auto measure = [&](auto&& notify){
+        const size_t before = alloc::count();
+        const auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < notifications; ++i){ notify(); }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return std::make_pair(elapsed.count() / notifications,
+                              double(alloc::count() - before) / notifications);
+    };
+    const auto [legacyNs, legacyAllocs] = measure([&]{
+        for(auto callback: legacy){ callback(sender); } // copies, as the old notify() did
+    });
+    const auto [inplaceNs, inplaceAllocs] = measure([&]{ current.notify(); });
+
+    std::cout << std::fixed << std::setprecision(2)
+              << " [BENCH] std::function by copy = " << legacyNs  << " ns/notify ; "
+              << legacyAllocs  << " allocations/notify\n"
+              << " [BENCH] InplaceCallback       = " << inplaceNs << " ns/notify ; "
+              << inplaceAllocs << " allocations/notify ; checksum = " << sum << '\n';
+}
+
+int main()
 {
     //QApplication app(argc, argv);
 
@@ -215,7 +378,7 @@ int main(int argc, char** argv)
         observerB.update(sender);
     });
     
-    model.onCounterChanged([&](void* sender){ 
+    auto labelConnection = model.onCounterChanged([&](void* sender){ 
         std::cout << " [CONSOLE VIEW] updating observerC \n";
         observerC.notify(sender); 
     });
@@ -223,6 +386,16 @@ int main(int argc, char** argv)
     std::cout << " -------------------------------- \n";
     //Simulate increment
     model.increment();
+
+    std::cout << " -------------------------------- \n";
+    //observerC is closed, a second disconnect with the same handle is a no-op
+    model.disconnect(labelConnection);
+    model.disconnect(labelConnection);
+    model.increment();
+
+    std::cout << " -------------------------------- \n";
+    const bool ok = checkNotifyDoesNotAllocate();
+    runCallbackBenchmark();
     //return app.exec();
-    return EXIT_SUCCESS;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
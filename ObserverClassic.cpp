@@ -11,8 +11,23 @@
 */
 
 #include <iostream>
+#include <cstdint>
 #include <iomanip>
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <tuple>
+#include <cassert>
+
+#include "AsyncLog.hpp"
+#include "Trace.hpp"
+#include "EpochReclaim.hpp"
+#include "SlotMap.hpp"
 
 //#include <QtWidgets>
 //#include <QApplication>
@@ -23,7 +38,10 @@ struct IObserver;
 struct IObservable 
 {
     /** Subscribe to observable notifications */
-    virtual void addObserver(IObserver* obs) = 0;
+    virtual Subscription addObserver(IObserver* obs) = 0;
+
+    /** Unsubscribe in O(1); a stale handle is ignored and false is returned */
+    virtual bool removeObserver(Subscription handle) = 0;
 
     /** Notify all observers */
     virtual void notify() = 0; 
@@ -36,63 +54,276 @@ struct IObserver
     virtual     ~IObserver() = default;
 };
 
+/** Observers must not be removed from inside their own update() */
 class BasicObservable: public IObservable 
 {
-    std::vector<IObserver*> m_observers{};
+    SlotMap<IObserver*> m_observers{};
 public:
 
-    void addObserver(IObserver* obs) override 
+    Subscription addObserver(IObserver* obs) override 
     {
-        m_observers.push_back(obs);
+        const auto handle = m_observers.insert(obs);
         obs->update(this);
+        return handle;
+    }
+
+    bool removeObserver(Subscription handle) override
+    {
+        return m_observers.erase(handle);
     }
 
     /** Notify all observers */
     void notify() override  
     {
+        TRACE_SCOPE("BasicObservable::notify");
         for(const auto obs: m_observers){ obs->update(this); }
     }    
 };
 
+/** Thread-safe observable based on a copy-on-write snapshot of the observer list.
+    addObserver() and removeObserver() copy the current list, modify the copy and publish it
+    with an atomic pointer exchange, while notify() only reads the published snapshot.
+    A notifying thread therefore never waits for a writer copying the list and
+    never sees a half-updated vector. A replaced snapshot is retired to the epoch
+    domain (EpochReclaim.hpp) and deleted once no notify() can still be iterating it:
+    notify() takes no lock and touches no reference count, it is wait-free.
+    The observable must not be destroyed while notify() runs.
+*/
+class ConcurrentObservable: public IObservable
+{
+    using ObserverList = SlotMap<IObserver*>;
+
+    std::atomic<const ObserverList*> m_observers{new ObserverList()};
+    std::mutex m_writeLock{}; // serializes writers only, readers never take it
+
+    void publish(std::unique_ptr<const ObserverList> next)
+    {
+        epoch::retire(m_observers.exchange(next.release(), std::memory_order_seq_cst));
+    }
+public:
+
+    ConcurrentObservable() = default;
+    ConcurrentObservable(const ConcurrentObservable&) = delete;
+    ConcurrentObservable& operator=(const ConcurrentObservable&) = delete;
+    ~ConcurrentObservable() override { delete m_observers.load(std::memory_order_acquire); }
+
+    Subscription addObserver(IObserver* obs) override 
+    {
+        Subscription handle;
+        {
+            std::lock_guard<std::mutex> lock(m_writeLock);
+            auto next = std::make_unique<ObserverList>(*m_observers.load(std::memory_order_acquire));
+            handle = next->insert(obs);
+            publish(std::move(next));
+        }
+        obs->update(this);
+        return handle;
+    }
+
+    /** Safe at any time, a notify() in progress keeps using its old snapshot */
+    bool removeObserver(Subscription handle) override
+    {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+        const ObserverList* current = m_observers.load(std::memory_order_acquire);
+        if(!current->contains(handle)){ return false; }
+        auto next = std::make_unique<ObserverList>(*current);
+        next->erase(handle);
+        publish(std::move(next));
+        return true;
+    }
+
+    /** Notify all observers present in the current snapshot */
+    void notify() override  
+    {
+        TRACE_SCOPE("ConcurrentObservable::notify");
+        epoch::Guard guard;
+        const ObserverList* snapshot = m_observers.load(std::memory_order_seq_cst);
+        for(const auto obs: *snapshot){ obs->update(this); }
+    }    
+};
+
+/** Counter whose change notifications can be batched and coalesced.
+    By default every change notifies the observers immediately. Changes made
+    between beginUpdate() and endUpdate() (or inside a CounterModel::Batch scope)
+    are merged into a single notification sent when the outermost batch ends.
+    setCoalescing() additionally merges changes outside batches until either
+    `maxChanges` changes are pending or `maxDelay` elapsed since the previous
+    notification; call flush() to deliver a pending tail right away.
+    Observers read the final value with get() and the number of changes merged
+    into the notification with mergedChanges().
+*/
 class CounterModel: public BasicObservable
 {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** RAII scope: one notification for all the changes made while it lives */
+    class Batch
+    {
+        CounterModel& m_model;
+    public:
+        explicit Batch(CounterModel& model): m_model(model) { m_model.beginUpdate(); }
+        ~Batch() { m_model.endUpdate(); }
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+    };
+
+private:
     int m_counter = 0;
+
+    int               m_batchDepth     = 0;
+    size_t            m_pendingChanges = 0;
+    size_t            m_mergedChanges  = 0;
+    size_t            m_maxChanges     = 1;
+    Clock::duration   m_maxDelay       = Clock::duration::max();
+    Clock::time_point m_lastNotify{};
+
+    void changed()
+    {
+        ++m_pendingChanges;
+        if(m_batchDepth > 0){ return; }
+        if(m_pendingChanges < m_maxChanges
+           && (m_maxDelay == Clock::duration::max() || Clock::now() - m_lastNotify < m_maxDelay)){
+            return;
+        }
+        flush();
+    }
 public: 
 
     void increment() 
     { 
         m_counter += 1;
-        this->notify();
+        this->changed();
     }
     void decrement() 
     {
         m_counter -= 1;
-        this->notify();
+        this->changed();
     }
     void reset()
     { 
         m_counter = 0;  
-        this->notify();
+        this->changed();
     }
 
     void set(int n)
     {
         m_counter = n;
+        this->changed();
+    }
+
+    int get() const { return m_counter; }
+
+    /** Number of changes merged into the notification being delivered */
+    size_t mergedChanges() const { return m_mergedChanges; }
+
+    void beginUpdate() { ++m_batchDepth; }
+
+    /** An endUpdate() without a matching beginUpdate() is a bug; release builds ignore it */
+    void endUpdate()
+    {
+        assert(m_batchDepth > 0 && "endUpdate() without beginUpdate()");
+        if(m_batchDepth == 0){ return; }
+        if(--m_batchDepth == 0){ flush(); }
+    }
+
+    /** Coalesce changes made outside batches, (1, max) restores immediate notification */
+    void setCoalescing(size_t maxChanges, Clock::duration maxDelay = Clock::duration::max())
+    {
+        m_maxChanges = maxChanges;
+        m_maxDelay   = maxDelay;
+    }
+
+    /** Deliver the pending changes, if any, in one notification */
+    void flush()
+    {
+        if(m_pendingChanges == 0){ return; }
+        m_mergedChanges  = m_pendingChanges;
+        m_pendingChanges = 0;
+        if(m_maxDelay != Clock::duration::max()){ m_lastNotify = Clock::now(); }
+        this->notify();
+    }
+};
+
+/** Counter that may be incremented from several threads at once */
+class ConcurrentCounterModel: public ConcurrentObservable
+{
+    std::atomic<int> m_counter{0};
+public: 
+
+    void increment() 
+    { 
+        m_counter.fetch_add(1, std::memory_order_relaxed);
         this->notify();
     }
 
+    int get() const { return m_counter.load(std::memory_order_relaxed); }
+};
+
+/** Observable whose observers are fixed at compile time.
+    The observers are held by reference in a tuple and receive the new state
+    directly through a non-virtual update(const State&), so every call can be
+    inlined and no observer needs to downcast the sender and pull the state.
+    Use it for topologies known at build time; BasicObservable stays the choice
+    when observers come and go at runtime.
+*/
+template<class... Observers>
+class StaticObservable
+{
+    std::tuple<Observers&...> m_observers;
+public:
+
+    explicit StaticObservable(Observers&... observers): m_observers(observers...) { }
+
+    /** Notify all observers */
+    template<class State>
+    void notify(const State& state)
+    {
+        std::apply([&state](auto&... obs){ (obs.update(state), ...); }, m_observers);
+    }
+};
+
+template<class... Observers>
+class StaticCounterModel: public StaticObservable<Observers...>
+{
+    int m_counter = 0;
+public:
+
+    explicit StaticCounterModel(Observers&... observers)
+        : StaticObservable<Observers...>(observers...)
+    {
+        this->notify(m_counter);
+    }
+
+    void increment() { m_counter += 1; this->notify(m_counter); }
+    void decrement() { m_counter -= 1; this->notify(m_counter); }
+    void reset()     { m_counter = 0;  this->notify(m_counter); }
+    void set(int n)  { m_counter = n;  this->notify(m_counter); }
+
     int get() const { return m_counter; }
 };
 
-/** Concrete observer that prints the subject state in the console (terminal) */
+template<class... Observers>
+StaticCounterModel(Observers&...) -> StaticCounterModel<Observers...>;
+
+/** Concrete observer that prints the subject state in the console (terminal).
+    It runs inside notify(): the line goes through AsyncLog, formatted off this thread. */
 class ConsoleView: public IObserver 
 {
+public:
     /* override: IObserver::update() */
     void update(IObservable* sender) override 
     {
         /* Note: It can result in undefined behavior. */
-        int cnt = static_cast<CounterModel*>(sender)->get();
-        std::cout << " [CONSOLE] Counter state changed to = " << cnt << '\n';
+        auto model = static_cast<CounterModel*>(sender);
+        ALOG(alog::Level::Info, " [CONSOLE] Counter state changed to = ", model->get(),
+             " ; merged changes = ", model->mergedChanges());
+    }
+
+    /** Push-model update used by StaticObservable, no downcast needed */
+    void update(int cnt)
+    {
+        ALOG(alog::Level::Info, " [CONSOLE] Counter state changed to = ", cnt);
     }
 };
 
@@ -138,9 +369,13 @@ public:
     /* override: IObserver::update() */
     void update(IObservable* sender) override 
     {
-        int cnt = static_cast<CounterModel*>(sender)->get();
+        update(static_cast<CounterModel*>(sender)->get());
+    }
+
+    void update(int cnt)
+    {
         //m_label->setText(QString::number(cnt)); 
-        std::cout << " [QT GUI] Counter state changed to = " << cnt << '\n';
+        ALOG(alog::Level::Info, " [QT GUI] Counter state changed to = ", cnt);
     }
 };
 
@@ -159,17 +394,254 @@ public:
     /* override: IObserver::update() */
     void update(IObservable* sender) override 
     {
-        int cnt = static_cast<CounterModel*>(sender)->get();
+        update(static_cast<CounterModel*>(sender)->get());
+    }
+
+    void update(int /*cnt*/)
+    {
         //m_label.setText(" [LABEL Observer] Counter value = " + QString::number(cnt));
     }
 
 };
 
+/** Observer counting the notifications it received */
+class TallyView: public IObserver
+{
+    std::atomic<long> m_updates{0};
+public:
+    void update(IObservable*) override 
+    {
+        m_updates.fetch_add(1, std::memory_order_relaxed);
+    }
+    long updates() const { return m_updates.load(); }
+};
+
+/** Keep the compiler from optimizing away a value computed by a benchmark loop */
+template<class T>
+inline void doNotOptimize(T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** Observer accumulating the values it sees, usable by both observable flavours */
+class SumView: public IObserver
+{
+    long m_sum = 0;
+public:
+    void update(IObservable* sender) override 
+    {
+        update(static_cast<CounterModel*>(sender)->get());
+    }
+    void update(int cnt)
+    {
+        m_sum += cnt;
+        doNotOptimize(m_sum);
+    }
+    long sum() const { return m_sum; }
+};
+
+/** Observer doing no work, so the benchmark only measures the notify path */
+class NullView: public IObserver
+{
+public:
+    void update(IObservable*) override { }
+};
+
+/** Workers increment the counter while the main thread keeps attaching and detaching observers.
+    Every observer must see its initial update plus at most one update per increment,
+    and the observer attached before the workers started must see all of them.
+*/
+bool runConcurrentStressTest()
+{
+    constexpr int threads = 8, increments = 20000, lateObservers = 64;
+
+    ConcurrentCounterModel model;
+    TallyView first{};
+    model.addObserver(&first);
+
+    std::vector<TallyView> late(lateObservers);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; ++t){
+        workers.emplace_back([&model]{
+            for(int i = 0; i < increments; ++i){ model.increment(); }
+        });
+    }
+    std::vector<Subscription> handles;
+    for(auto& obs: late){
+        handles.push_back(model.addObserver(&obs));
+        std::this_thread::yield();
+    }
+    for(size_t i = 0; i < handles.size(); i += 2){
+        model.removeObserver(handles[i]);
+        std::this_thread::yield();
+    }
+    for(auto& w: workers){ w.join(); }
+
+    const long total = long(threads) * increments;
+    bool ok = model.get() == total && first.updates() == total + 1
+              && !model.removeObserver(handles[0]);
+    for(const auto& obs: late){
+        ok = ok && obs.updates() >= 1 && obs.updates() <= total + 1;
+    }
+    std::cout << " [STRESS] counter = " << model.get()
+              << " ; first observer updates = " << first.updates()
+              << " ; result = " << (ok ? "PASS" : "FAIL") << '\n';
+    return ok;
+}
+
+/** Notifications per second when `threads` threads call notify() concurrently */
+template<class Observable>
+double measureNotifyThroughput(int threads, int notifiesPerThread)
+{
+    Observable subject;
+    std::vector<NullView> views(8);
+    for(auto& v: views){ subject.addObserver(&v); }
+
+    std::vector<std::thread> workers;
+    const auto start = std::chrono::steady_clock::now();
+    for(int t = 0; t < threads; ++t){
+        workers.emplace_back([&subject, notifiesPerThread]{
+            for(int i = 0; i < notifiesPerThread; ++i){ subject.notify(); }
+        });
+    }
+    for(auto& w: workers){ w.join(); }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return double(threads) * notifiesPerThread / elapsed.count();
+}
+
+/** BasicObservable is only safe here because nobody attaches or detaches during the run */
+void runNotifyBenchmark()
+{
+    constexpr int totalNotifies = 1 << 20;
+    std::cout << std::setw(10) << "threads"
+              << std::setw(20) << "basic [notify/s]"
+              << std::setw(20) << "snapshot [notify/s]" << '\n';
+    for(int threads: {1, 8, 64}){
+        const int perThread = totalNotifies / threads;
+        std::cout << std::setw(10) << threads
+                  << std::setw(20) << std::fixed << std::setprecision(0)
+                  << measureNotifyThroughput<BasicObservable>(threads, perThread)
+                  << std::setw(20)
+                  << measureNotifyThroughput<ConcurrentObservable>(threads, perThread) << '\n';
+    }
+}
+
+/** Notifications delivered for a burst of increments under a given coalescing setup */
+template<class Setup>
+void measureCoalescing(const char* label, Setup setup)
+{
+    constexpr int increments = 1 << 20;
+    CounterModel model;
+    TallyView view{};
+    model.addObserver(&view);
+    const long before = view.updates();
+
+    const auto start = CounterModel::Clock::now();
+    setup(model, increments);
+    model.flush();
+    const std::chrono::duration<double> elapsed = CounterModel::Clock::now() - start;
+
+    const long notifications = view.updates() - before;
+    std::cout << std::setw(22) << label
+              << std::setw(16) << notifications
+              << std::setw(20) << std::fixed << std::setprecision(0) << notifications / elapsed.count()
+              << std::setw(20) << increments / elapsed.count() << '\n';
+}
+
+void runCoalescingBenchmark()
+{
+    std::cout << std::setw(22) << "mode"
+              << std::setw(16) << "notifications"
+              << std::setw(20) << "[notify/s]"
+              << std::setw(20) << "[increment/s]" << '\n';
+    measureCoalescing("immediate", [](CounterModel& m, int n){
+        for(int i = 0; i < n; ++i){ m.increment(); }
+    });
+    measureCoalescing("every 64 changes", [](CounterModel& m, int n){
+        m.setCoalescing(64);
+        for(int i = 0; i < n; ++i){ m.increment(); }
+    });
+    measureCoalescing("every 1 ms", [](CounterModel& m, int n){
+        m.setCoalescing(std::numeric_limits<size_t>::max(), std::chrono::milliseconds{1});
+        for(int i = 0; i < n; ++i){ m.increment(); }
+    });
+    measureCoalescing("batches of 1000", [](CounterModel& m, int n){
+        for(int i = 0; i < n; i += 1000){
+            CounterModel::Batch batch{m};
+            for(int j = i; j < std::min(n, i + 1000); ++j){ m.increment(); }
+        }
+    });
+}
+
+/** Subscribe/unsubscribe churn interleaved with notifications.
+    A fixed population of observers is kept attached; every cycle detaches a
+    pseudo-random one, attaches a replacement and, every 8 cycles, notifies.
+*/
+void runChurnBenchmark()
+{
+    constexpr int population = 1024, cycles = 1 << 21;
+    BasicObservable subject;
+    NullView view{};
+    std::vector<Subscription> live;
+    for(int i = 0; i < population; ++i){ live.push_back(subject.addObserver(&view)); }
+
+    uint32_t seed = 12345;
+    size_t staleIgnored = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < cycles; ++i){
+        seed = seed * 1664525u + 1013904223u;
+        auto& handle = live[seed % population];
+        const Subscription stale = handle;
+        subject.removeObserver(handle);
+        handle = subject.addObserver(&view);
+        staleIgnored += !subject.removeObserver(stale);
+        if(i % 8 == 0){ subject.notify(); }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::fixed << std::setprecision(0)
+              << " [CHURN] " << cycles / elapsed.count() << " subscribe/unsubscribe cycles/s"
+              << " ; stale handles ignored = " << staleIgnored << '\n';
+}
+
+/** Nanoseconds per increment() with three observers attached */
+template<class Model>
+double measureNotificationCost(Model& model, int increments)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < increments; ++i){ model.increment(); }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / increments;
+}
+
+void runStaticVersusDynamicBenchmark()
+{
+    constexpr int increments = 1 << 22;
+    SumView a{}, b{}, c{};
+    CounterModel dynamicModel;
+    dynamicModel.addObserver(&a);
+    dynamicModel.addObserver(&b);
+    dynamicModel.addObserver(&c);
+    const double dynamicCost = measureNotificationCost(dynamicModel, increments);
+
+    SumView x{}, y{}, z{};
+    StaticCounterModel staticModel{x, y, z};
+    const double staticCost = measureNotificationCost(staticModel, increments);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << " [BENCH] dynamic (virtual + pull) = " << dynamicCost << " ns/notification\n"
+              << " [BENCH] static  (inlined push)   = " << staticCost  << " ns/notification\n";
+    if(a.sum() != x.sum()){ std::cout << " [BENCH] observers disagree!\n"; }
+}
 
 int main(int argc, char** argv)
 {
     //QApplication app(argc, argv);
 
+    // --trace=FILE records the notifications of the demo below, not the benchmarks
+    const auto traceFile = trace::fileFromArgs(argc, argv);
+    trace::setEnabled(traceFile.has_value());
+
     CounterModel model;     
     ConsoleView  observerA{};
     FormView     observerB{model};
@@ -177,11 +649,46 @@ int main(int argc, char** argv)
 
     model.addObserver(&observerA);
     model.addObserver(&observerB);
-    model.addObserver(&observerC);
+    const auto labelSubscription = model.addObserver(&observerC);
 
+    alog::flush(); // the observers log asynchronously, keep their lines in place
     std::cout << " -------------------------------- \n";
     //Simulate increment
     model.increment();
 
-    return EXIT_SUCCESS;
+    //Simulate a burst delivered as a single notification
+    {
+        CounterModel::Batch batch{model};
+        for(int i = 0; i < 10; ++i){ model.increment(); }
+        model.decrement();
+    }
+
+    //The label view goes away, removing it twice is harmless
+    model.removeObserver(labelSubscription);
+    model.removeObserver(labelSubscription);
+    model.increment();
+
+    alog::flush();
+    std::cout << "\n ------ Compile-time observers ------ \n";
+    StaticCounterModel staticModel{observerA, observerB, observerC};
+    staticModel.increment();
+    trace::setEnabled(false);
+    alog::flush();
+    if(traceFile){
+        const bool saved = trace::save(*traceFile);
+        std::cout << (saved ? " Trace written to " : " Cannot write the trace to ") << *traceFile << '\n';
+    }
+    runStaticVersusDynamicBenchmark();
+
+    std::cout << "\n ------ Subscription churn ------ \n";
+    runChurnBenchmark();
+
+    std::cout << "\n ------ Coalesced notify ------ \n";
+    runCoalescingBenchmark();
+
+    std::cout << "\n ------ Concurrent notify ------ \n";
+    const bool ok = runConcurrentStressTest();
+    runNotifyBenchmark();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
\ No newline at end of file
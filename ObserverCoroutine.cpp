@@ -0,0 +1,397 @@
+// Observer-Observable with C++20 coroutines
+/*
+    Instead of registering a callback, a consumer is written as a coroutine which
+    waits for the changes of the subject:
+
+        int value = co_await model.changed(executor);   // next change only
+
+        auto values = model.values(executor);           // every change, as a stream
+        while(auto value = co_await values.next()){ ... }
+
+    (C++20 dropped the "for co_await" loop of the Coroutines TS, the while loop above is its equivalent.)
+
+    The consumer logic reads top to bottom, keeps its state in local variables and no lambda
+    captures references to objects whose lifetime the subject does not know about:
+    a stream unregisters itself when the coroutine frame holding it is destroyed.
+
+    Waiting coroutines are never resumed from inside increment(); they are handed to the
+    executor chosen by the consumer, which decides where and when they run.
+    A stream whose consumer lags behind keeps only the latest value (coalescing) and counts
+    the values it skipped.
+    The subject and its executors are single-threaded: ManualScheduler runs the resumed
+    coroutines when the owner calls run(), which keeps tests deterministic.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <coroutine>
+#include <optional>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <exception>
+#include <utility>
+#include <chrono>
+
+struct IExecutor
+{
+    /** Resume the coroutine at some later point */
+    virtual void schedule(std::coroutine_handle<> coroutine) = 0;
+
+    /** Forget the coroutine if it is still scheduled: it is about to be destroyed */
+    virtual void cancel(std::coroutine_handle<> coroutine) = 0;
+
+    virtual     ~IExecutor() = default;
+};
+
+/** Single-threaded executor resuming coroutines only when asked to */
+class ManualScheduler: public IExecutor
+{
+    std::deque<std::coroutine_handle<>> m_ready{};
+public:
+
+    void schedule(std::coroutine_handle<> coroutine) override
+    {
+        m_ready.push_back(coroutine);
+    }
+
+    void cancel(std::coroutine_handle<> coroutine) override
+    {
+        std::erase(m_ready, coroutine);
+    }
+
+    /** Resume everything ready, including coroutines made ready meanwhile. Returns the count. */
+    size_t run()
+    {
+        size_t n = 0;
+        while(!m_ready.empty()){
+            auto coroutine = m_ready.front();
+            m_ready.pop_front();
+            coroutine.resume();
+            ++n;
+        }
+        return n;
+    }
+};
+
+/** Coroutine return type. The coroutine starts suspended until start() hands it to an executor.
+    Destroying the task removes the coroutine from that executor's queue, so a later run()
+    does not resume a freed frame. The executor must outlive the task, and a task
+    awaiting through another executor must not be destroyed while queued there.
+*/
+class Task
+{
+public:
+    struct promise_type
+    {
+        Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() { }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    explicit Task(std::coroutine_handle<promise_type> handle): m_handle(handle) { }
+    Task(Task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, {})), m_executor(std::exchange(other.m_executor, nullptr))
+    { }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&) = delete;
+
+    ~Task()
+    {
+        if(!m_handle){ return; }
+        if(m_executor){ m_executor->cancel(m_handle); }
+        m_handle.destroy();
+    }
+
+    void start(IExecutor& executor)
+    {
+        m_executor = &executor;
+        executor.schedule(m_handle);
+    }
+    bool done() const { return m_handle.done(); }
+private:
+    std::coroutine_handle<promise_type> m_handle;
+    IExecutor*                          m_executor{nullptr};
+};
+
+class CounterModel;
+
+/** Every change of a CounterModel, coalesced to the latest value while the consumer is busy */
+class ValueStream
+{
+    friend class CounterModel;
+
+    CounterModel*           m_model;
+    IExecutor&              m_executor;
+    std::optional<int>      m_pending{};
+    std::coroutine_handle<> m_waiting{};
+    size_t                  m_coalesced{0};
+
+    void push(int value)
+    {
+        if(m_pending){ ++m_coalesced; }
+        m_pending = value;
+        if(m_waiting){ m_executor.schedule(std::exchange(m_waiting, {})); }
+    }
+
+    /** The model is going away: wake the consumer, next() returns nullopt */
+    void close()
+    {
+        m_model = nullptr;
+        if(m_waiting){ m_executor.schedule(std::exchange(m_waiting, {})); }
+    }
+public:
+
+    ValueStream(CounterModel& model, IExecutor& executor);
+    ~ValueStream();
+    ValueStream(const ValueStream&) = delete;
+    ValueStream& operator=(const ValueStream&) = delete;
+
+    struct NextAwaiter
+    {
+        ValueStream& stream;
+
+        bool await_ready() const { return stream.m_pending.has_value() || stream.m_model == nullptr; }
+        void await_suspend(std::coroutine_handle<> coroutine) { stream.m_waiting = coroutine; }
+        std::optional<int> await_resume() { return std::exchange(stream.m_pending, std::nullopt); }
+    };
+
+    /** Latest value not consumed yet, or nullopt once the model is destroyed */
+    NextAwaiter next() { return NextAwaiter{*this}; }
+
+    /** Number of values replaced by a newer one before the consumer got to them */
+    size_t coalesced() const { return m_coalesced; }
+};
+
+class CounterModel
+{
+public:
+    /** Awaiter for the next change only; nullopt if the model is destroyed first */
+    class ChangedAwaiter
+    {
+        friend class CounterModel;
+
+        CounterModel*           m_model;
+        IExecutor&              m_executor;
+        std::coroutine_handle<> m_waiting{};
+        std::optional<int>      m_value{};
+    public:
+        ChangedAwaiter(CounterModel& model, IExecutor& executor)
+            : m_model(&model), m_executor(executor)
+        { }
+
+        // A destroyed, still suspended coroutine must not stay registered
+        ~ChangedAwaiter()
+        {
+            if(m_waiting && m_model){ std::erase(m_model->m_oneShot, this); }
+        }
+
+        bool await_ready() const { return m_model == nullptr; }
+        void await_suspend(std::coroutine_handle<> coroutine)
+        {
+            m_waiting = coroutine;
+            m_model->m_oneShot.push_back(this);
+        }
+        std::optional<int> await_resume() const { return m_value; }
+    };
+
+private:
+    friend class ValueStream;
+
+    int                          m_counter{0};
+    std::vector<ChangedAwaiter*> m_oneShot{};
+    std::vector<ValueStream*>    m_streams{};
+
+    /** Hand the waiting coroutines to their executors */
+    void notify()
+    {
+        auto oneShot = std::exchange(m_oneShot, {});
+        for(auto awaiter: oneShot){
+            awaiter->m_value = m_counter;
+            awaiter->m_executor.schedule(std::exchange(awaiter->m_waiting, {}));
+        }
+        for(auto stream: m_streams){ stream->push(m_counter); }
+    }
+public:
+
+    CounterModel() = default;
+    CounterModel(const CounterModel&) = delete;
+    CounterModel& operator=(const CounterModel&) = delete;
+
+    /** Wakes every waiting consumer: changed() yields nullopt, next() too */
+    ~CounterModel()
+    {
+        for(auto awaiter: m_oneShot){
+            awaiter->m_model = nullptr;
+            awaiter->m_executor.schedule(std::exchange(awaiter->m_waiting, {}));
+        }
+        for(auto stream: m_streams){ stream->close(); }
+    }
+
+    void increment() { m_counter += 1; notify(); }
+    void decrement() { m_counter -= 1; notify(); }
+    int  get() const { return m_counter; }
+
+    /** co_await model.changed(executor) => value after the next change, resumed on executor,
+        or nullopt if the model is destroyed before changing */
+    ChangedAwaiter changed(IExecutor& executor) { return ChangedAwaiter{*this, executor}; }
+
+    /** Stream of all the changes from now on, consumed by co_await stream.next() */
+    ValueStream values(IExecutor& executor) { return ValueStream{*this, executor}; }
+};
+
+ValueStream::ValueStream(CounterModel& model, IExecutor& executor)
+    : m_model(&model), m_executor(executor)
+{
+    model.m_streams.push_back(this);
+}
+
+ValueStream::~ValueStream()
+{
+    if(m_model){ std::erase(m_model->m_streams, this); }
+}
+
+class FormView
+{
+public:
+    void update(int cnt)
+    {
+        //m_label->setText(QString::number(cnt));
+        std::cout << " [QT GUI] Counter state changed to = " << cnt << '\n';
+    }
+};
+
+//---------- Consumers -----------//
+
+Task consoleView(CounterModel& model, IExecutor& executor)
+{
+    if(auto cnt = co_await model.changed(executor)){
+        std::cout << " [CONSOLE VIEW] First change, counter = " << *cnt << '\n';
+    }
+}
+
+Task firstChange(CounterModel& model, IExecutor& executor, std::optional<int>& result)
+{
+    result = co_await model.changed(executor);
+}
+
+/** A model destroyed while consumers wait on changed() must not leave them registered:
+    the waiting consumer is resumed with nullopt, and a consumer destroyed without ever
+    being resumed again must not touch the destroyed model.
+*/
+bool runModelDestroyedCheck()
+{
+    bool ok = true;
+    {
+        ManualScheduler scheduler;
+        std::optional<CounterModel> model{std::in_place};
+        std::optional<int> result{-1};
+        Task waiting = firstChange(*model, scheduler, result);
+        waiting.start(scheduler);
+        scheduler.run();
+        model.reset();
+        scheduler.run();
+        ok = ok && waiting.done() && !result.has_value();
+    }
+    {
+        ManualScheduler scheduler;
+        std::optional<CounterModel> model{std::in_place};
+        std::optional<int> result{-1};
+        std::optional<Task> waiting{firstChange(*model, scheduler, result)};
+        waiting->start(scheduler);
+        scheduler.run();
+        model.reset();
+        waiting.reset(); // destroyed while its resumption is still queued
+        ok = ok && scheduler.run() == 0 && result == -1;
+    }
+    std::cout << " [CHECK] model destroyed while awaited: " << (ok ? "PASS" : "FAIL") << '\n';
+    return ok;
+}
+
+Task formView(CounterModel& model, FormView& view, IExecutor& executor)
+{
+    auto values = model.values(executor);
+    while(auto cnt = co_await values.next()){
+        view.update(*cnt);
+    }
+    std::cout << " [QT GUI] Model destroyed, " << values.coalesced() << " values coalesced\n";
+}
+
+Task sumConsumer(CounterModel& model, IExecutor& executor, long& sum)
+{
+    auto values = model.values(executor);
+    while(auto cnt = co_await values.next()){ sum += *cnt; }
+}
+
+/** Nanoseconds per delivered value: callback invocation versus coroutine resumption */
+void runSwitchBenchmark()
+{
+    constexpr int changes = 1 << 20;
+    using Clock = std::chrono::steady_clock;
+
+    long callbackSum = 0;
+    std::vector<std::function<void (int)>> callbacks{[&callbackSum](int cnt){ callbackSum += cnt; }};
+    int counter = 0;
+    auto start = Clock::now();
+    for(int i = 0; i < changes; ++i){
+        ++counter;
+        for(const auto& callback: callbacks){ callback(counter); }
+    }
+    const std::chrono::duration<double, std::nano> callbackTime = Clock::now() - start;
+
+    long coroutineSum = 0;
+    ManualScheduler scheduler;
+    {
+        CounterModel model;
+        Task consumer = sumConsumer(model, scheduler, coroutineSum);
+        consumer.start(scheduler);
+        scheduler.run();
+        start = Clock::now();
+        for(int i = 0; i < changes; ++i){
+            model.increment();
+            scheduler.run();
+        }
+    }
+    const std::chrono::duration<double, std::nano> coroutineTime = Clock::now() - start;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << " [BENCH] callback  = " << callbackTime.count() / changes  << " ns/value\n"
+              << " [BENCH] coroutine = " << coroutineTime.count() / changes << " ns/value (suspend + schedule + resume)\n"
+              << " [BENCH] same result = " << (callbackSum == coroutineSum ? "yes" : "NO") << '\n';
+}
+
+int main()
+{
+    ManualScheduler guiLoop;
+    FormView        observerB{};
+    std::optional<CounterModel> model{std::in_place};
+
+    Task viewA = consoleView(*model, guiLoop);
+    Task viewB = formView(*model, observerB, guiLoop);
+    viewA.start(guiLoop);
+    viewB.start(guiLoop);
+    guiLoop.run(); // both views are now waiting for changes
+
+    std::cout << " -------------------------------- \n";
+    //Simulate increment
+    model->increment();
+    guiLoop.run();
+
+    //A burst while the GUI loop is busy elsewhere: the view only sees the latest value
+    for(int i = 0; i < 5; ++i){ model->increment(); }
+    guiLoop.run();
+
+    //Destroying the model ends the streams
+    model.reset();
+    guiLoop.run();
+
+    const bool ok = runModelDestroyedCheck();
+
+    std::cout << "\n ------ Context switch cost ------ \n";
+    runSwitchBenchmark();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,368 @@
+// Observer-Observable with thread-affine connections (Qt signals and slots style)
+/*
+    GUI widgets, such as FormView and LabelView, may only be touched from the thread that owns them.
+    In ObserverCallback.cpp every callback runs on whichever thread calls increment(),
+    so a worker thread changing the model would end up updating widgets from the wrong thread.
+
+    This variant attaches every connection to the EventLoop of the receiver and lets the
+    connection type decide where and when the slot runs:
+        Direct         => the slot runs immediately on the emitting thread.
+        Queued         => the arguments are copied into an event posted to the receiver loop;
+                          the emitting thread returns immediately.
+        BlockingQueued => like Queued, but the emitting thread waits until the slot has run.
+                          Rejected with a warning, as Qt does, when emitted from the receiver
+                          loop thread or to a loop that has stopped: either would wait forever.
+        Auto           => Direct when emitted from the receiver loop thread, Queued otherwise.
+
+    The event loop is fed through a lock-free MPSC (multi-producer single-consumer) queue,
+    so producer threads never take a lock and never pay for the rendering of the views.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#include "EpochReclaim.hpp"
+
+/** Unbounded lock-free MPSC queue (Dmitry Vyukov's node based algorithm).
+    push() is a single atomic exchange; only the owner thread may call tryPop().
+*/
+template<typename T>
+class MpscQueue
+{
+    struct Node
+    {
+        std::atomic<Node*> next{nullptr};
+        T                  value{};
+    };
+
+    alignas(64) std::atomic<Node*> m_head; // producers append here
+    alignas(64) Node*              m_tail; // consumer removes from here, always a stub node
+public:
+
+    MpscQueue()
+    {
+        Node* stub = new Node;
+        m_head.store(stub, std::memory_order_relaxed);
+        m_tail = stub;
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while(tryPop(value)){ }
+        delete m_tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value)
+    {
+        Node* node = new Node;
+        node->value = std::move(value);
+        Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool tryPop(T& value)
+    {
+        Node* tail = m_tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if(next == nullptr){ return false; }
+        value  = std::move(next->value);
+        m_tail = next;
+        delete tail;
+        return true;
+    }
+};
+
+/** Runs posted events on the thread that created it */
+class EventLoop
+{
+    MpscQueue<std::function<void ()>> m_events{};
+    std::atomic<uint32_t>             m_posted{0};   // bumped on every post, used to sleep/wake
+    std::atomic<bool>                 m_quit{false};
+    std::mutex                        m_stopLock{};  // orders tryPost() against the end of exec()
+    bool                              m_stopped{false};
+    const std::thread::id             m_owner{std::this_thread::get_id()};
+public:
+
+    bool isInLoopThread() const { return std::this_thread::get_id() == m_owner; }
+
+    /** Thread-safe, lock-free */
+    void post(std::function<void ()> event)
+    {
+        m_events.push(std::move(event));
+        m_posted.fetch_add(1, std::memory_order_release);
+        m_posted.notify_one();
+    }
+
+    /** Thread-safe. Returns false, without posting, once exec() has returned; an event
+        accepted here is guaranteed to run. Takes a lock, unlike post(). */
+    bool tryPost(std::function<void ()> event)
+    {
+        std::lock_guard<std::mutex> lock(m_stopLock);
+        if(m_stopped){ return false; }
+        post(std::move(event));
+        return true;
+    }
+
+    /** Run the events already queued without blocking. Returns the number processed. */
+    size_t processEvents()
+    {
+        std::function<void ()> event;
+        size_t n = 0;
+        while(m_events.tryPop(event)){
+            event();
+            ++n;
+        }
+        return n;
+    }
+
+    /** Process events until quit() is called. Must be called from the owner thread. */
+    void exec()
+    {
+        while(!m_quit.load(std::memory_order_acquire)){
+            const uint32_t seen = m_posted.load(std::memory_order_acquire);
+            if(processEvents() == 0){ m_posted.wait(seen, std::memory_order_acquire); }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_stopLock);
+            m_stopped = true;
+        }
+        processEvents(); // also runs whatever tryPost() accepted before m_stopped was set
+    }
+
+    /** Thread-safe */
+    void quit()
+    {
+        post([this]{ m_quit.store(true, std::memory_order_release); });
+    }
+};
+
+enum class ConnectionType { Auto, Direct, Queued, BlockingQueued };
+
+/** A notification source; each connection remembers the loop that owns its receiver.
+    connect() may run while other threads emit(): the connection list is copied on write,
+    published with an atomic pointer exchange and reclaimed through the epoch domain
+    (EpochReclaim.hpp), so emit() still takes no lock. A queued event owns a reference to
+    its connection, so it stays valid after a later connect() or the Signal's destruction.
+    The Signal itself must not be destroyed while emit() runs.
+*/
+template<typename... Args>
+class Signal
+{
+    struct Connection
+    {
+        EventLoop*                     loop;
+        std::function<void (Args...)>  slot;
+        ConnectionType                 type;
+    };
+    using ConnectionList = std::vector<std::shared_ptr<const Connection>>;
+
+    std::atomic<const ConnectionList*> m_connections{new ConnectionList()};
+    std::mutex                         m_connectLock{}; // serializes connect() only
+
+    static void invokeBlocking(EventLoop& loop, const std::function<void (Args...)>& slot,
+                               const Args&... args)
+    {
+        if(loop.isInLoopThread()){
+            std::cerr << " [WARNING] Signal::emit: BlockingQueued connection to the loop of the emitting thread,"
+                         " dead lock avoided, slot not called\n";
+            return;
+        }
+        std::atomic<bool> done{false};
+        const bool posted = loop.tryPost([&]{
+            slot(args...);
+            done.store(true, std::memory_order_release);
+            done.notify_one();
+        });
+        if(!posted){
+            std::cerr << " [WARNING] Signal::emit: BlockingQueued connection to a stopped loop, slot not called\n";
+            return;
+        }
+        done.wait(false, std::memory_order_acquire);
+    }
+public:
+
+    Signal() = default;
+    Signal(const Signal&) = delete;
+    Signal& operator=(const Signal&) = delete;
+    ~Signal() { delete m_connections.load(std::memory_order_acquire); }
+
+    /** Thread-safe, also against emit() */
+    void connect(EventLoop& receiverLoop, std::function<void (Args...)> slot,
+                 ConnectionType type = ConnectionType::Auto)
+    {
+        auto connection = std::make_shared<const Connection>(Connection{&receiverLoop, std::move(slot), type});
+        std::lock_guard<std::mutex> lock(m_connectLock);
+        auto next = std::make_unique<ConnectionList>(*m_connections.load(std::memory_order_acquire));
+        next->push_back(std::move(connection));
+        epoch::retire(m_connections.exchange(next.release(), std::memory_order_seq_cst));
+    }
+
+    /** Notify all connected slots */
+    void emit(const Args&... args) const
+    {
+        epoch::Guard guard;
+        for(const auto& connection: *m_connections.load(std::memory_order_seq_cst)){
+            const Connection& c = *connection;
+            ConnectionType type = c.type;
+            if(type == ConnectionType::Auto){
+                type = c.loop->isInLoopThread() ? ConnectionType::Direct : ConnectionType::Queued;
+            }
+            switch(type){
+            case ConnectionType::Direct:
+                c.slot(args...);
+                break;
+            case ConnectionType::Queued:
+                c.loop->post([connection, args...]{ connection->slot(args...); });
+                break;
+            case ConnectionType::BlockingQueued:
+                invokeBlocking(*c.loop, c.slot, args...);
+                break;
+            case ConnectionType::Auto:
+                break;
+            }
+        }
+    }
+};
+
+class CounterModel
+{
+    std::atomic<int> m_counter{0};
+public:
+    /** Carries the new counter value */
+    Signal<int> counterChanged{};
+
+    void increment() { counterChanged.emit(m_counter.fetch_add(1) + 1); }
+    void decrement() { counterChanged.emit(m_counter.fetch_sub(1) - 1); }
+    int  get() const { return m_counter.load(); }
+};
+
+/** Widget stand-in remembering its owner thread, like a QWidget */
+class FormView
+{
+    const std::thread::id m_owner{std::this_thread::get_id()};
+    int                   m_wrongThreadUpdates{0};
+public:
+
+    void update(int cnt)
+    {
+        const bool onOwner = std::this_thread::get_id() == m_owner;
+        if(!onOwner){ ++m_wrongThreadUpdates; }
+        //m_label->setText(QString::number(cnt));
+        std::cout << " [QT GUI] Counter state changed to = " << cnt
+                  << " ; on GUI thread = " << (onOwner ? "yes" : "NO") << '\n';
+    }
+
+    int wrongThreadUpdates() const { return m_wrongThreadUpdates; }
+};
+
+class LabelView
+{
+    const std::thread::id m_owner{std::this_thread::get_id()};
+public:
+
+    void notify(int cnt)
+    {
+        //m_label.setText(" [LABEL Observer] Counter value = " + QString::number(cnt));
+        std::cout << " [LABEL] Counter value = " << cnt
+                  << " ; on GUI thread = " << (std::this_thread::get_id() == m_owner ? "yes" : "NO") << '\n';
+    }
+};
+
+using Clock = std::chrono::steady_clock;
+
+/** Percentile of a set of latencies, in microseconds */
+double percentile(std::vector<double> samples, double p)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<size_t>(p * (samples.size() - 1))];
+}
+
+/** A worker thread emits `events` changes that are delivered to a slot on the main thread loop */
+void measureDelivery(const char* label, ConnectionType type, int events)
+{
+    EventLoop guiLoop;
+    CounterModel model;
+    std::vector<Clock::time_point> sent(events + 1), received(events + 1);
+
+    model.counterChanged.connect(guiLoop, [&received](int cnt){ received[cnt] = Clock::now(); }, type);
+
+    Clock::duration producerTime{};
+    std::thread worker([&]{
+        const auto start = Clock::now();
+        for(int i = 1; i <= events; ++i){
+            sent[i] = Clock::now();
+            model.increment();
+        }
+        producerTime = Clock::now() - start;
+        guiLoop.quit();
+    });
+    const auto start = Clock::now();
+    guiLoop.exec();
+    const std::chrono::duration<double> total = Clock::now() - start;
+    worker.join();
+
+    std::vector<double> latencies;
+    for(int i = 1; i <= events; ++i){
+        latencies.push_back(std::chrono::duration<double, std::micro>(received[i] - sent[i]).count());
+    }
+    std::cout << std::setw(16) << label
+              << std::setw(16) << std::fixed << std::setprecision(0) << events / total.count()
+              << std::setw(16) << std::setprecision(1)
+              << std::chrono::duration<double, std::nano>(producerTime).count() / events
+              << std::setw(14) << percentile(latencies, 0.50)
+              << std::setw(14) << percentile(latencies, 0.99) << '\n';
+}
+
+void runDeliveryBenchmark()
+{
+    std::cout << std::setw(16) << "connection"
+              << std::setw(16) << "[events/s]"
+              << std::setw(16) << "emit() [ns]"
+              << std::setw(14) << "p50 [us]"
+              << std::setw(14) << "p99 [us]" << '\n';
+    measureDelivery("queued",          ConnectionType::Queued,         200000);
+    measureDelivery("blocking-queued", ConnectionType::BlockingQueued, 20000);
+}
+
+int main()
+{
+    EventLoop    guiLoop;   // main thread is the GUI thread
+    CounterModel model;
+    FormView     observerB{};
+    LabelView    observerC{};
+
+    model.counterChanged.connect(guiLoop, [](int cnt){
+        std::cout << " [CONSOLE VIEW] Counter state changed to = " << cnt << '\n';
+    }, ConnectionType::Direct);
+    model.counterChanged.connect(guiLoop, [&](int cnt){ observerB.update(cnt); });
+    model.counterChanged.connect(guiLoop, [&](int cnt){ observerC.notify(cnt); });
+
+    std::cout << " -------------------------------- \n";
+    //Simulate increments coming from a worker thread
+    std::thread worker([&]{
+        for(int i = 0; i < 3; ++i){ model.increment(); }
+        guiLoop.quit();
+    });
+    guiLoop.exec(); //return app.exec();
+    worker.join();
+
+    //Emitting from the GUI thread itself runs the slots directly
+    model.decrement();
+
+    std::cout << "\n ------ Queued delivery to the GUI thread ------ \n";
+    runDeliveryBenchmark();
+    return observerB.wrongThreadUpdates() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,318 @@
+// Publish/Subscribe event bus with hierarchical topics
+/*
+    The Observable of ObserverCallback.cpp carries a single "counter changed" event.
+    A model with many named properties would need one Observable per property and every
+    observer would have to know the object publishing it.
+
+    In the publish/subscribe variant, publishers and subscribers only share an EventBus and
+    topic names. Topics are hierarchical, levels are separated by '/', for instance
+        counter/value      model/window/title      model/window/size
+    and subscription patterns may contain wildcards (MQTT syntax, see the examples below).
+
+    Subscriptions are stored in a trie whose edges are interned level ids, so publishing walks
+    at most one exact branch plus the wildcard branches for each topic level:
+    the cost depends on the topic depth and on the number of matching subscribers,
+    not on the total number of subscriptions.
+    Publishers on hot paths compile their topic once with EventBus::topic().
+*/
+
+//Wildcards:
+//  *  => matches exactly one level:                   counter/*  matches counter/value
+//  #  => matches any number of levels, must be last:  model/#    matches model and model/window/title
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstdint>
+#include <chrono>
+
+template<typename Payload>
+class EventBus
+{
+public:
+    using Callback = std::function<void (std::string_view topic, const Payload& payload)>;
+
+    /** Topic prepared for publishing: its levels are already interned */
+    class Topic
+    {
+        friend class EventBus;
+        std::string           m_name;
+        std::vector<uint32_t> m_levels;
+    public:
+        const std::string& name() const { return m_name; }
+    };
+
+private:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    struct Node
+    {
+        uint32_t              single = None; // child reached through '*'
+        uint32_t              multi  = None; // child holding the '#' subscribers
+        std::vector<Callback> subscribers{};
+    };
+
+    std::vector<Node>                         m_nodes{Node{}}; // m_nodes[0] is the root
+    std::unordered_map<std::string, uint32_t> m_levelIds{};
+    std::unordered_map<uint64_t, uint32_t>    m_children{};    // (parent node, level id) -> node
+
+    static uint64_t edge(uint32_t parent, uint32_t level)
+    {
+        return (uint64_t(parent) << 32) | level;
+    }
+
+    template<typename F>
+    static void forEachLevel(std::string_view name, F&& f)
+    {
+        size_t start = 0;
+        for(;;){
+            const size_t end = name.find('/', start);
+            f(name.substr(start, end - start), end == std::string_view::npos);
+            if(end == std::string_view::npos){ return; }
+            start = end + 1;
+        }
+    }
+
+    uint32_t intern(std::string_view level)
+    {
+        const auto [it, inserted] = m_levelIds.try_emplace(std::string(level), uint32_t(m_levelIds.size()));
+        return it->second;
+    }
+
+    uint32_t lookup(std::string_view level) const
+    {
+        const auto it = m_levelIds.find(std::string(level));
+        return it == m_levelIds.end() ? None : it->second;
+    }
+
+    uint32_t newNode()
+    {
+        m_nodes.emplace_back();
+        return uint32_t(m_nodes.size() - 1);
+    }
+
+    size_t deliver(const Node& node, std::string_view topic, const Payload& payload) const
+    {
+        for(const auto& callback: node.subscribers){ callback(topic, payload); }
+        return node.subscribers.size();
+    }
+
+    size_t match(uint32_t index, const std::vector<uint32_t>& levels, size_t depth,
+                 std::string_view topic, const Payload& payload) const
+    {
+        const Node& node = m_nodes[index];
+        size_t delivered = 0;
+        if(node.multi != None){ delivered += deliver(m_nodes[node.multi], topic, payload); }
+        if(depth == levels.size()){ return delivered + deliver(node, topic, payload); }
+
+        if(levels[depth] != None){
+            const auto it = m_children.find(edge(index, levels[depth]));
+            if(it != m_children.end()){ delivered += match(it->second, levels, depth + 1, topic, payload); }
+        }
+        if(node.single != None){ delivered += match(node.single, levels, depth + 1, topic, payload); }
+        return delivered;
+    }
+public:
+
+    /** Subscribe to every topic matching the pattern */
+    void subscribe(std::string_view pattern, Callback callback)
+    {
+        uint32_t node = 0;
+        forEachLevel(pattern, [&](std::string_view level, bool last){
+            if(level == "#"){
+                if(!last){ throw std::invalid_argument("'#' must be the last level of a pattern"); }
+                if(m_nodes[node].multi == None){
+                    const uint32_t child = newNode();
+                    m_nodes[node].multi = child;
+                }
+                node = m_nodes[node].multi;
+            } else if(level == "*"){
+                if(m_nodes[node].single == None){
+                    const uint32_t child = newNode();
+                    m_nodes[node].single = child;
+                }
+                node = m_nodes[node].single;
+            } else {
+                const auto key = edge(node, intern(level));
+                const auto it  = m_children.find(key);
+                if(it != m_children.end()){
+                    node = it->second;
+                } else {
+                    const uint32_t child = newNode();
+                    m_children.emplace(key, child);
+                    node = child;
+                }
+            }
+        });
+        m_nodes[node].subscribers.push_back(std::move(callback));
+    }
+
+    /** Compile a topic once, for publishers calling publish() repeatedly */
+    Topic topic(std::string_view name)
+    {
+        Topic t;
+        t.m_name = std::string(name);
+        forEachLevel(name, [&](std::string_view level, bool){ t.m_levels.push_back(intern(level)); });
+        return t;
+    }
+
+    /** Returns the number of subscribers notified */
+    size_t publish(const Topic& topic, const Payload& payload) const
+    {
+        return match(0, topic.m_levels, 0, topic.m_name, payload);
+    }
+
+    /** Convenience overload, resolves the topic levels on every call */
+    size_t publish(std::string_view name, const Payload& payload) const
+    {
+        std::vector<uint32_t> levels;
+        forEachLevel(name, [&](std::string_view level, bool){ levels.push_back(lookup(level)); });
+        return match(0, levels, 0, name, payload);
+    }
+};
+
+class CounterModel
+{
+    int                         m_counter{0};
+    EventBus<int>&              m_bus;
+    const EventBus<int>::Topic  m_valueTopic;
+public:
+    explicit CounterModel(EventBus<int>& bus)
+        : m_bus(bus), m_valueTopic(bus.topic("counter/value"))
+    { }
+
+    void increment() { m_counter += 1; m_bus.publish(m_valueTopic, m_counter); }
+    void decrement() { m_counter -= 1; m_bus.publish(m_valueTopic, m_counter); }
+    int  get() const { return m_counter; }
+};
+
+class FormView
+{
+public:
+    void update(int cnt)
+    {
+        //m_label->setText(QString::number(cnt));
+        std::cout << " [QT GUI] Counter state changed to = " << cnt << '\n';
+    }
+};
+
+/** Naive bus for comparison: every publish matches the topic against every pattern */
+class LinearBus
+{
+    struct Subscription
+    {
+        std::vector<std::string> levels;
+        std::function<void ()>   callback;
+    };
+    std::vector<Subscription> m_subscriptions{};
+
+    static std::vector<std::string> split(std::string_view name)
+    {
+        std::vector<std::string> levels;
+        size_t start = 0, end;
+        while((end = name.find('/', start)) != std::string_view::npos){
+            levels.emplace_back(name.substr(start, end - start));
+            start = end + 1;
+        }
+        levels.emplace_back(name.substr(start));
+        return levels;
+    }
+public:
+    void subscribe(std::string_view pattern, std::function<void ()> callback)
+    {
+        m_subscriptions.push_back({split(pattern), std::move(callback)});
+    }
+
+    void publish(std::string_view name) const
+    {
+        const auto topic = split(name);
+        for(const auto& s: m_subscriptions){
+            size_t i = 0;
+            bool matched = true;
+            for(; i < s.levels.size(); ++i){
+                if(s.levels[i] == "#"){ break; }
+                if(i >= topic.size() || (s.levels[i] != "*" && s.levels[i] != topic[i])){
+                    matched = false;
+                    break;
+                }
+            }
+            if(matched && (i < s.levels.size() || i == topic.size())){ s.callback(); }
+        }
+    }
+};
+
+template<typename F>
+double nanosecondsPerCall(int calls, F&& f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < calls; ++i){ f(); }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / calls;
+}
+
+/** `subscriptions` spread over model/p<k>/value topics (10 per topic) plus a few wildcards */
+void measurePublish(int subscriptions)
+{
+    EventBus<int> bus;
+    LinearBus     linear;
+    size_t hits = 0;
+    const int topics = subscriptions / 10;
+    for(int i = 0; i < subscriptions; ++i){
+        const std::string pattern = "model/p" + std::to_string(i % topics) + "/value";
+        bus.subscribe(pattern, [&hits](std::string_view, const int&){ ++hits; });
+        linear.subscribe(pattern, [&hits]{ ++hits; });
+    }
+    for(const char* pattern: {"model/*/value", "model/#", "#"}){
+        bus.subscribe(pattern, [&hits](std::string_view, const int&){ ++hits; });
+        linear.subscribe(pattern, [&hits]{ ++hits; });
+    }
+
+    const auto topic = bus.topic("model/p7/value");
+    size_t matched = 0;
+    const double trieNs = nanosecondsPerCall(100000, [&]{ matched = bus.publish(topic, 1); });
+    const double linearNs = nanosecondsPerCall(5, [&]{ linear.publish("model/p7/value"); });
+
+    std::cout << std::setw(14) << subscriptions
+              << std::setw(10) << matched
+              << std::setw(18) << std::fixed << std::setprecision(1) << trieNs
+              << std::setw(20) << linearNs << '\n';
+}
+
+void runPublishBenchmark()
+{
+    std::cout << std::setw(14) << "subscriptions"
+              << std::setw(10) << "matched"
+              << std::setw(18) << "trie [ns/pub]"
+              << std::setw(20) << "linear [ns/pub]" << '\n';
+    for(int n: {10000, 100000, 1000000}){ measurePublish(n); }
+}
+
+int main()
+{
+    EventBus<int> bus;
+    CounterModel  model{bus};
+    FormView      observerB{};
+
+    bus.subscribe("counter/*", [](std::string_view topic, const int& cnt){
+        std::cout << " [CONSOLE VIEW] " << topic << " changed to = " << cnt << '\n';
+    });
+    bus.subscribe("counter/value", [&](std::string_view, const int& cnt){ observerB.update(cnt); });
+    bus.subscribe("#", [](std::string_view topic, const int&){
+        std::cout << " [AUDIT] published on " << topic << '\n';
+    });
+
+    std::cout << " -------------------------------- \n";
+    //Simulate increment
+    model.increment();
+    //Other publishers share the same bus
+    bus.publish("model/window/width", 640);
+
+    std::cout << "\n ------ Publish cost ------ \n";
+    runPublishBenchmark();
+    return EXIT_SUCCESS;
+}
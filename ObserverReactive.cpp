@@ -0,0 +1,541 @@
+// Observer-Observable with reactive operators
+/*
+    Observers of ObserverCallback.cpp often filter or rate limit the notifications by hand
+    inside their lambda. Reactive libraries (ReactiveX) offer these behaviours as reusable operators:
+        map(f)                  => transform each value.
+        filter(p)               => forward only the values satisfying p.
+        buffer(n)               => forward the values in groups of n.
+        throttle(t)             => forward a value, then ignore the following ones during t.
+        debounce(t)             => forward a value only once no other value arrived during t.
+        sample(t)               => every t, forward the latest value if a new one arrived.
+        bufferTime(t)           => every t, forward the values received meanwhile.
+
+    Operators are chained with '|' into a Pipeline, which is only a list of operator descriptions:
+        auto pipeline = pipe<int>() | filter(isEven) | map(toText) | throttle(100ms, scheduler);
+        model.onCounterChanged(pipeline.to(sink));
+    to() fuses all the stages into one callable, built from the sink backwards, in which every
+    stage calls the next one directly: there are no intermediate observables and nothing is
+    allocated per value. Stateful time-based stages allocate their state once, when subscribing;
+    the state embeds the stage's Timer, an intrusive slot the scheduler links into its queue,
+    so arming a timer does not allocate either. bufferTime() reuses its vector: it grows to the
+    largest window seen, then stops allocating.
+
+    Time-based operators read time and set timers through an IScheduler.
+    VirtualScheduler is a scheduler whose time only moves when advanceBy() is called,
+    which makes tests of time-based behaviour deterministic and instantaneous.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <tuple>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <chrono>
+
+//---------------- Schedulers -------------------//
+
+struct IScheduler;
+
+/** Timer slot embedded in the object it calls back: the scheduler links the slot itself
+    into its queue, so arming, re-arming and cancelling never allocate.
+    A slot is queued at most once; destroying it cancels it.
+*/
+class Timer
+{
+    friend class VirtualScheduler;
+
+    void      (*m_fire)(void* context);
+    void*       m_context;
+    IScheduler* m_scheduler{nullptr};  // set while queued
+    Timer*      m_next{nullptr};       // scheduler bookkeeping
+    std::chrono::steady_clock::time_point m_when{};
+public:
+
+    Timer(void (*fire)(void* context), void* context): m_fire(fire), m_context(context) { }
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+    inline ~Timer();
+
+    bool armed() const { return m_scheduler != nullptr; }
+};
+
+struct IScheduler
+{
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+    using Duration  = Clock::duration;
+
+    virtual TimePoint now() const = 0;
+
+    /** Fire the timer once the scheduler time reaches `when`; an armed timer is moved */
+    virtual void arm(Timer& timer, TimePoint when) = 0;
+
+    /** Unqueue the timer if it is armed */
+    virtual void cancel(Timer& timer) = 0;
+
+    virtual     ~IScheduler() = default;
+};
+
+Timer::~Timer()
+{
+    if(m_scheduler){ m_scheduler->cancel(*this); }
+}
+
+/** Scheduler with a virtual clock, driven by advanceBy().
+    The timers form a singly linked list sorted by deadline: a handful of stages, short scans.
+*/
+class VirtualScheduler: public IScheduler
+{
+    TimePoint m_now{};
+    Timer*    m_first{nullptr};
+public:
+
+    VirtualScheduler() = default;
+    VirtualScheduler(const VirtualScheduler&) = delete;
+    VirtualScheduler& operator=(const VirtualScheduler&) = delete;
+
+    ~VirtualScheduler()
+    {
+        while(m_first){ cancel(*m_first); }
+    }
+
+    TimePoint now() const override { return m_now; }
+
+    void arm(Timer& timer, TimePoint when) override
+    {
+        cancel(timer);
+        timer.m_when      = when;
+        timer.m_scheduler = this;
+        Timer** link = &m_first;
+        while(*link && (*link)->m_when <= when){ link = &(*link)->m_next; } // FIFO on ties
+        timer.m_next = *link;
+        *link = &timer;
+    }
+
+    void cancel(Timer& timer) override
+    {
+        if(timer.m_scheduler != this){ return; }
+        for(Timer** link = &m_first; *link; link = &(*link)->m_next){
+            if(*link == &timer){
+                *link = timer.m_next;
+                break;
+            }
+        }
+        timer.m_next      = nullptr;
+        timer.m_scheduler = nullptr;
+    }
+
+    /** Move the clock forward, running the due timers in time order */
+    void advanceBy(Duration delta)
+    {
+        const TimePoint target = m_now + delta;
+        while(m_first && m_first->m_when <= target){
+            Timer& timer = *m_first;
+            cancel(timer);
+            m_now = std::max(m_now, timer.m_when);
+            timer.m_fire(timer.m_context); // may re-arm it
+        }
+        m_now = target;
+    }
+};
+
+//---------------- Operators -------------------//
+// Every operator provides:
+//   Output<In>       => type of the values it forwards for input values of type In.
+//   wrap<In>(down)   => the fused stage: a callable taking an In and calling down.
+
+template<typename F>
+struct Map
+{
+    F f;
+
+    template<typename In>
+    using Output = std::decay_t<std::invoke_result_t<const F&, const In&>>;
+
+    template<typename In, typename Down>
+    auto wrap(Down down) const
+    {
+        return [f = f, down = std::move(down)](const In& value) mutable { down(f(value)); };
+    }
+};
+
+template<typename P>
+struct Filter
+{
+    P predicate;
+
+    template<typename In>
+    using Output = In;
+
+    template<typename In, typename Down>
+    auto wrap(Down down) const
+    {
+        return [p = predicate, down = std::move(down)](const In& value) mutable {
+            if(p(value)){ down(value); }
+        };
+    }
+};
+
+struct Buffer
+{
+    size_t count;
+
+    template<typename In>
+    using Output = std::vector<In>;
+
+    template<typename In, typename Down>
+    auto wrap(Down down) const
+    {
+        std::vector<In> group;
+        group.reserve(count);
+        return [n = count, group = std::move(group), down = std::move(down)](const In& value) mutable {
+            group.push_back(value);
+            if(group.size() == n){
+                down(static_cast<const std::vector<In>&>(group));
+                group.clear();
+            }
+        };
+    }
+};
+
+struct Throttle
+{
+    IScheduler::Duration window;
+    IScheduler&          scheduler;
+
+    template<typename In>
+    using Output = In;
+
+    template<typename In, typename Down>
+    auto wrap(Down down) const
+    {
+        return [window = window, sched = &scheduler, down = std::move(down),
+                next = std::optional<IScheduler::TimePoint>{}](const In& value) mutable {
+            const auto now = sched->now();
+            if(next && now < *next){ return; }
+            next = now + window;
+            down(value);
+        };
+    }
+};
+
+struct Debounce
+{
+    IScheduler::Duration quiet;
+    IScheduler&          scheduler;
+
+    template<typename In>
+    using Output = In;
+
+    template<typename In, typename Down>
+    struct State
+    {
+        Down                    down;
+        IScheduler&             scheduler;
+        IScheduler::Duration    quiet;
+        std::optional<In>       latest{};
+        IScheduler::TimePoint   deadline{};
+        Timer                   timer{&State::fire, this};
+
+        State(Down down, IScheduler& scheduler, IScheduler::Duration quiet)
+            : down(std::move(down)), scheduler(scheduler), quiet(quiet)
+        { }
+
+        // Armed once per quiet period, not per value: when it fires early it re-arms itself
+        static void fire(void* context)
+        {
+            State& s = *static_cast<State*>(context);
+            if(s.scheduler.now() < s.deadline){ return s.scheduler.arm(s.timer, s.deadline); }
+            In value = std::move(*s.latest);
+            s.latest.reset();
+            s.down(value);
+        }
+    };
+
+    template<typename In, typename Down>
+    auto wrap(Down down) const
+    {
+        auto state = std::make_shared<State<In, Down>>(std::move(down), scheduler, quiet);
+        return [state](const In& value){
+            state->latest   = value;
+            state->deadline = state->scheduler.now() + state->quiet;
+            if(!state->timer.armed()){ state->scheduler.arm(state->timer, state->deadline); }
+        };
+    }
+};
+
+/** Shared implementation of sample() and bufferTime(): a periodic timer flushing an accumulator.
+    The timer stops ticking when the subscription, which owns the state, goes away. */
+template<typename Accumulator, typename Down>
+struct PeriodicState
+{
+    Down                 down;
+    IScheduler&          scheduler;
+    IScheduler::Duration period;
+    Accumulator          pending{};
+    Timer                timer{&PeriodicState::fire, this};
+
+    PeriodicState(Down down, IScheduler& scheduler, IScheduler::Duration period)
+        : down(std::move(down)), scheduler(scheduler), period(period)
+    { }
+
+    void arm() { scheduler.arm(timer, scheduler.now() + period); }
+
+    static void fire(void* context)
+    {
+        PeriodicState& s = *static_cast<PeriodicState*>(context);
+        if(!s.pending.empty()){ s.flush(); }
+        s.arm();
+    }
+
+    void flush()
+    {
+        if constexpr(requires { pending.value(); }){
+            auto value = std::move(*pending);
+            pending.reset();
+            down(value);
+        } else {
+            down(static_cast<const Accumulator&>(pending)); // cleared, not moved out: keeps its capacity
+            pending.clear();
+        }
+    }
+};
+
+/** std::optional with the empty() of a container, so PeriodicState handles both cases */
+template<typename T>
+struct Latest: std::optional<T>
+{
+    bool empty() const { return !this->has_value(); }
+};
+
+struct Sample
+{
+    IScheduler::Duration period;
+    IScheduler&          scheduler;
+
+    template<typename In>
+    using Output = In;
+
+    template<typename In, typename Down>
+    auto wrap(Down down) const
+    {
+        using State = PeriodicState<Latest<In>, Down>;
+        auto state = std::make_shared<State>(std::move(down), scheduler, period);
+        state->arm();
+        return [state](const In& value){ state->pending.emplace(value); };
+    }
+};
+
+struct BufferTime
+{
+    IScheduler::Duration period;
+    IScheduler&          scheduler;
+
+    template<typename In>
+    using Output = std::vector<In>;
+
+    template<typename In, typename Down>
+    auto wrap(Down down) const
+    {
+        using State = PeriodicState<std::vector<In>, Down>;
+        auto state = std::make_shared<State>(std::move(down), scheduler, period);
+        state->arm();
+        return [state](const In& value){ state->pending.push_back(value); };
+    }
+};
+
+template<typename F> Map<F>    map(F f)           { return {std::move(f)}; }
+template<typename P> Filter<P> filter(P predicate) { return {std::move(predicate)}; }
+inline Buffer     buffer(size_t count)                                  { return {count}; }
+inline Throttle   throttle(IScheduler::Duration t, IScheduler& s)      { return {t, s}; }
+inline Debounce   debounce(IScheduler::Duration t, IScheduler& s)      { return {t, s}; }
+inline Sample     sample(IScheduler::Duration t, IScheduler& s)        { return {t, s}; }
+inline BufferTime bufferTime(IScheduler::Duration t, IScheduler& s)    { return {t, s}; }
+
+/** Chain of operators for values of type In, fused into one callable by to() */
+template<typename In, typename... Ops>
+class Pipeline
+{
+    std::tuple<Ops...> m_ops;
+
+    template<size_t I, typename Value, typename Sink>
+    auto fuseFrom(Sink sink) const
+    {
+        if constexpr(I == sizeof...(Ops)){
+            return sink;
+        } else {
+            using Op  = std::tuple_element_t<I, std::tuple<Ops...>>;
+            using Out = typename Op::template Output<Value>;
+            return std::get<I>(m_ops).template wrap<Value>(fuseFrom<I + 1, Out>(std::move(sink)));
+        }
+    }
+public:
+
+    explicit Pipeline(std::tuple<Ops...> ops = {}): m_ops(std::move(ops)) { }
+
+    template<typename Op>
+    Pipeline<In, Ops..., Op> operator|(Op op) const
+    {
+        return Pipeline<In, Ops..., Op>{std::tuple_cat(m_ops, std::make_tuple(std::move(op)))};
+    }
+
+    /** The fused callable: takes an In, runs every stage and finally the sink */
+    template<typename Sink>
+    auto to(Sink sink) const
+    {
+        return fuseFrom<0, In>(std::move(sink));
+    }
+};
+
+template<typename In>
+Pipeline<In> pipe() { return Pipeline<In>{}; }
+
+//---------------- Observable -------------------//
+
+template<typename T>
+using ValueCallback = std::function<void (const T& value)>;
+
+class CounterModel
+{
+    int m_counter{0};
+    std::vector<ValueCallback<int>> m_observers{};
+
+    void notify() { for(const auto& callback: m_observers){ callback(m_counter); } }
+public:
+    void increment() { m_counter += 1; notify(); }
+    void decrement() { m_counter -= 1; notify(); }
+    int  get() const { return m_counter; }
+
+    void onCounterChanged(ValueCallback<int> callback)
+    {
+        m_observers.push_back(std::move(callback));
+    }
+};
+
+template<typename T>
+std::string toString(const std::vector<T>& values)
+{
+    std::string s = "[";
+    for(const auto& v: values){ s += (s.size() > 1 ? ", " : "") + std::to_string(v); }
+    return s + "]";
+}
+
+/** Values seen by a sink, compared against the expected ones */
+bool expect(const char* label, const std::string& got, const std::string& expected)
+{
+    const bool ok = got == expected;
+    std::cout << " [" << label << "] " << got << (ok ? "" : "   expected " + expected) << '\n';
+    return ok;
+}
+
+/** Deterministic checks of the time-based operators on a virtual clock */
+bool runTimeOperatorChecks()
+{
+    using namespace std::chrono_literals;
+    VirtualScheduler scheduler;
+    CounterModel model;
+    std::vector<int> throttled, debounced, sampled;
+    std::vector<std::vector<int>> buffered;
+
+    model.onCounterChanged((pipe<int>() | throttle(100ms, scheduler))
+                           .to([&](const int& v){ throttled.push_back(v); }));
+    model.onCounterChanged((pipe<int>() | debounce(50ms, scheduler))
+                           .to([&](const int& v){ debounced.push_back(v); }));
+    model.onCounterChanged((pipe<int>() | sample(100ms, scheduler))
+                           .to([&](const int& v){ sampled.push_back(v); }));
+    model.onCounterChanged((pipe<int>() | bufferTime(100ms, scheduler))
+                           .to([&](const std::vector<int>& v){ buffered.push_back(v); }));
+
+    // Bursts of 3 increments 20 ms apart, then 190 ms of silence, twice.
+    // The bursts land in [0 ms, 60 ms) and [250 ms, 310 ms), the 100 ms ticks fall between them.
+    for(int burst = 0; burst < 2; ++burst){
+        for(int i = 0; i < 3; ++i){
+            model.increment();
+            scheduler.advanceBy(20ms);
+        }
+        scheduler.advanceBy(190ms);
+    }
+
+    std::string groups;
+    for(const auto& g: buffered){ groups += toString(g); }
+    bool ok = expect("THROTTLE", toString(throttled), "[1, 4]");
+    ok = expect("DEBOUNCE", toString(debounced), "[3, 6]") && ok;
+    ok = expect("SAMPLE  ", toString(sampled),   "[3, 6]") && ok;
+    ok = expect("BUFFER  ", groups,              "[1, 2, 3][4, 5, 6]") && ok;
+    return ok;
+}
+
+/** 8 fused stages versus the same logic written by hand in one lambda */
+void runFusionBenchmark()
+{
+    constexpr int values = 1 << 23;
+    long fusedSum = 0, handSum = 0;
+
+    ValueCallback<int> fused = (pipe<int>()
+        | map([](int x){ return x + 1; })
+        | filter([](int x){ return x % 3 != 0; })
+        | map([](int x){ return x * 5; })
+        | filter([](int x){ return (x & 7) != 1; })
+        | map([](int x){ return x ^ 0x55; })
+        | filter([](int x){ return x > 16; })
+        | map([](int x){ return long(x) * 2; })
+        | map([](long x){ return x - 7; })
+        ).to([&fusedSum](const long& x){ fusedSum += x; });
+
+    ValueCallback<int> hand = [&handSum](const int& v){
+        int x = v + 1;
+        if(x % 3 == 0){ return; }
+        x *= 5;
+        if((x & 7) == 1){ return; }
+        x ^= 0x55;
+        if(x <= 16){ return; }
+        handSum += long(x) * 2 - 7;
+    };
+
+    auto measure = [](const ValueCallback<int>& callback){
+        const auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < values; ++i){ callback(i); }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / values;
+    };
+    const double fusedNs = measure(fused);
+    const double handNs  = measure(hand);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << " [BENCH] 8-stage fused pipeline = " << fusedNs << " ns/value\n"
+              << " [BENCH] hand-written lambda    = " << handNs  << " ns/value\n"
+              << " [BENCH] same result = " << (fusedSum == handSum ? "yes" : "NO") << '\n';
+}
+
+int main()
+{
+    CounterModel model;
+
+    model.onCounterChanged([](const int& cnt){
+        std::cout << " [CONSOLE VIEW] Counter state changed to = " << cnt << '\n';
+    });
+
+    //Only even values, shown as text, in groups of two
+    model.onCounterChanged((pipe<int>()
+        | filter([](int cnt){ return cnt % 2 == 0; })
+        | buffer(2)
+        ).to([](const std::vector<int>& cnts){
+            std::cout << " [QT GUI] Even counter values = " << toString(cnts) << '\n';
+        }));
+
+    std::cout << " -------------------------------- \n";
+    //Simulate increments
+    for(int i = 0; i < 4; ++i){ model.increment(); }
+
+    std::cout << "\n ------ Time-based operators (virtual clock) ------ \n";
+    const bool ok = runTimeOperatorChecks();
+
+    std::cout << "\n ------ Fusion ------ \n";
+    runFusionBenchmark();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,421 @@
+// Observer-Observable across processes through a shared-memory ring buffer (Linux)
+/*
+    The IObservable/IObserver pair of ObserverClassic.cpp only works inside one process.
+    Here the counter model runs in one process and the views in other processes of the same host.
+
+    A SharedMemoryPublisher is an ordinary IObserver of the CounterModel: on every update it
+    writes the counter value into a ring buffer living in POSIX shared memory (shm_open + mmap).
+    Viewer processes map the same segment and read the events straight out of it:
+    no sockets, no serialization, no copies through the kernel.
+
+    The ring has a single producer and any number of consumers:
+        - The producer never waits for the consumers, it simply overwrites the oldest slot.
+        - Every consumer keeps its own cursor (the sequence number of the next event to read).
+          A consumer that falls more than one ring behind detects the overrun, counts the lost
+          events and resumes from the oldest event still available.
+        - Each slot is protected by a sequence number (seqlock): odd while being written,
+          so a reader racing with the producer retries instead of returning a torn event.
+        - Idle consumers sleep on a futex placed in the shared segment; the producer only
+          issues the wake-up system call when a consumer is actually sleeping.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <system_error>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
+
+//---------------- Classic observer (see ObserverClassic.cpp) -------------------//
+
+struct IObserver;
+
+struct IObservable
+{
+    /** Subscribe to observable notifications */
+    virtual void addObserver(IObserver* obs) = 0;
+
+    /** Notify all observers */
+    virtual void notify() = 0;
+    virtual     ~IObservable() = default;
+};
+
+struct IObserver
+{
+    virtual void update(IObservable* sender) = 0;
+    virtual     ~IObserver() = default;
+};
+
+class BasicObservable: public IObservable
+{
+    std::vector<IObserver*> m_observers{};
+public:
+
+    void addObserver(IObserver* obs) override
+    {
+        m_observers.push_back(obs);
+        obs->update(this);
+    }
+
+    /** Notify all observers */
+    void notify() override
+    {
+        for(const auto obs: m_observers){ obs->update(this); }
+    }
+};
+
+class CounterModel: public BasicObservable
+{
+    int m_counter = 0;
+public:
+
+    void increment()
+    {
+        m_counter += 1;
+        this->notify();
+    }
+
+    int get() const { return m_counter; }
+};
+
+//---------------- Shared-memory ring -------------------//
+
+constexpr uint64_t RingCapacity = 4096;
+
+/** What a remote observer receives */
+struct CounterEvent
+{
+    int64_t value;
+    int64_t sentNs;   // steady_clock (CLOCK_MONOTONIC) time of publication, for latency
+};
+
+// Atomics placed in memory shared between processes must not rely on a hidden lock
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free);
+
+struct RingSlot
+{
+    std::atomic<uint64_t> sequence{0};  // 2n+1 while event n is being written, 2n+2 once written
+    std::atomic<int64_t>  value{0};
+    std::atomic<int64_t>  sentNs{0};
+};
+
+struct SharedRing
+{
+    alignas(64) std::atomic<uint64_t> head{0};      // number of events published
+    alignas(64) std::atomic<uint32_t> signal{0};    // futex word, bumped on every publish
+    std::atomic<uint32_t>             sleepers{0};  // consumers blocked on the futex
+    std::atomic<uint32_t>             closed{0};
+    std::atomic<uint32_t>             attached{0};  // consumers ready to read
+    alignas(64) RingSlot              slots[RingCapacity];
+};
+
+static void futexWait(std::atomic<uint32_t>* word, uint32_t expected)
+{
+    // Not FUTEX_PRIVATE: the word is shared between processes
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+static void futexWakeAll(std::atomic<uint32_t>* word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/** Mapping of a named POSIX shared-memory segment holding a SharedRing */
+class SharedMemory
+{
+    std::string m_name;
+    bool        m_owner;
+    SharedRing* m_ring{nullptr};
+
+    SharedMemory(std::string name, bool create): m_name(std::move(name)), m_owner(create)
+    {
+        const int fd = shm_open(m_name.c_str(), create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0600);
+        if(fd < 0){ throw std::system_error(errno, std::generic_category(), "shm_open " + m_name); }
+        // The segment was created above: it must not outlive a failure below
+        auto fail = [&](int err, const char* what){
+            close(fd);
+            if(create){ shm_unlink(m_name.c_str()); }
+            throw std::system_error(err, std::generic_category(), what);
+        };
+        if(create && ftruncate(fd, sizeof(SharedRing)) != 0){ fail(errno, "ftruncate"); }
+        void* p = mmap(nullptr, sizeof(SharedRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(p == MAP_FAILED){ fail(errno, "mmap"); }
+        close(fd);
+        m_ring = create ? new (p) SharedRing{} : static_cast<SharedRing*>(p);
+    }
+public:
+
+    /** Create the segment (producer side) */
+    static SharedMemory create(const std::string& name) { return SharedMemory{name, true}; }
+
+    /** Map an existing segment (consumer side) */
+    static SharedMemory open(const std::string& name) { return SharedMemory{name, false}; }
+
+    SharedMemory(SharedMemory&& other) noexcept
+        : m_name(std::move(other.m_name)), m_owner(other.m_owner), m_ring(std::exchange(other.m_ring, nullptr))
+    { }
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+    SharedMemory& operator=(SharedMemory&&) = delete;
+
+    ~SharedMemory()
+    {
+        if(m_ring == nullptr){ return; }
+        munmap(m_ring, sizeof(SharedRing));
+        if(m_owner){ shm_unlink(m_name.c_str()); }
+    }
+
+    SharedRing& ring() { return *m_ring; }
+};
+
+class RingProducer
+{
+    SharedRing& m_ring;
+public:
+    explicit RingProducer(SharedRing& ring): m_ring(ring) { }
+
+    void publish(const CounterEvent& event)
+    {
+        const uint64_t n = m_ring.head.load(std::memory_order_relaxed);
+        RingSlot& slot = m_ring.slots[n % RingCapacity];
+        slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.value.store(event.value, std::memory_order_relaxed);
+        slot.sentNs.store(event.sentNs, std::memory_order_relaxed);
+        slot.sequence.store(2 * n + 2, std::memory_order_release);
+        m_ring.head.store(n + 1, std::memory_order_release);
+
+        m_ring.signal.fetch_add(1);
+        if(m_ring.sleepers.load() > 0){ futexWakeAll(&m_ring.signal); }
+    }
+
+    /** No more events: wakes up every consumer */
+    void close()
+    {
+        m_ring.closed.store(1);
+        m_ring.signal.fetch_add(1);
+        futexWakeAll(&m_ring.signal);
+    }
+};
+
+class RingConsumer
+{
+    SharedRing& m_ring;
+    uint64_t    m_cursor;
+    uint64_t    m_lost{0};
+public:
+    /** Starts with the next event published */
+    explicit RingConsumer(SharedRing& ring)
+        : m_ring(ring), m_cursor(ring.head.load(std::memory_order_acquire))
+    {
+        m_ring.attached.fetch_add(1);
+    }
+
+    /** Non-blocking read of the event at the cursor */
+    bool tryRead(CounterEvent& event)
+    {
+        for(;;){
+            const uint64_t head = m_ring.head.load(std::memory_order_acquire);
+            if(m_cursor == head){ return false; }
+            if(head - m_cursor > RingCapacity){
+                // Overrun: the producer lapped us, skip to the oldest event still in the ring
+                m_lost  += head - m_cursor - RingCapacity;
+                m_cursor = head - RingCapacity;
+            }
+            const RingSlot& slot = m_ring.slots[m_cursor % RingCapacity];
+            const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if(before != 2 * m_cursor + 2){ continue; } // being overwritten, re-check the head
+            event.value  = slot.value.load(std::memory_order_relaxed);
+            event.sentNs = slot.sentNs.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(slot.sequence.load(std::memory_order_relaxed) != before){ continue; } // torn read
+            ++m_cursor;
+            return true;
+        }
+    }
+
+    /** Blocking read; returns false once the producer closed the ring and everything was read */
+    bool read(CounterEvent& event)
+    {
+        for(;;){
+            if(tryRead(event)){ return true; }
+            const uint32_t seen = m_ring.signal.load();
+            if(tryRead(event)){ return true; }
+            if(m_ring.closed.load()){ return false; }
+            m_ring.sleepers.fetch_add(1);
+            futexWait(&m_ring.signal, seen);
+            m_ring.sleepers.fetch_sub(1);
+        }
+    }
+
+    uint64_t lost() const { return m_lost; }
+};
+
+/** Local observer forwarding every change of the model to the remote observers */
+class SharedMemoryPublisher: public IObserver
+{
+    RingProducer m_producer;
+public:
+    explicit SharedMemoryPublisher(SharedRing& ring): m_producer(ring) { }
+
+    void update(IObservable* sender) override
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        m_producer.publish({static_cast<CounterModel*>(sender)->get(),
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()});
+    }
+
+    void close() { m_producer.close(); }
+};
+
+//---------------- Viewer process -------------------//
+
+/** Latency histogram with power-of-two nanosecond buckets */
+class LatencyHistogram
+{
+    uint64_t m_buckets[64]{};
+    uint64_t m_count{0};
+    int64_t  m_max{0};
+public:
+    void record(int64_t ns)
+    {
+        const int bucket = ns <= 1 ? 0 : 64 - __builtin_clzll(static_cast<uint64_t>(ns - 1));
+        ++m_buckets[bucket];
+        ++m_count;
+        m_max = std::max(m_max, ns);
+    }
+
+    /** Upper bound, in ns, of the bucket holding the p-th percentile */
+    int64_t percentile(double p) const
+    {
+        const uint64_t rank = static_cast<uint64_t>(p * m_count);
+        uint64_t seen = 0;
+        for(int b = 0; b < 64; ++b){
+            seen += m_buckets[b];
+            if(seen > rank){ return int64_t(1) << b; }
+        }
+        return m_max;
+    }
+
+    void print(std::ostream& os) const
+    {
+        for(int b = 0; b < 64; ++b){
+            if(m_buckets[b] == 0){ continue; }
+            os << "    <= " << std::setw(10) << (int64_t(1) << b) << " ns : "
+               << std::setw(8) << m_buckets[b] << '\n';
+        }
+    }
+};
+
+/** Body of a viewer process: read every event until the producer closes the ring */
+int runViewer(const std::string& shmName, int viewerId)
+{
+    auto shm = SharedMemory::open(shmName);
+    RingConsumer consumer{shm.ring()};
+    LatencyHistogram histogram;
+
+    std::ostringstream out;
+    CounterEvent event{};
+    uint64_t received = 0;
+    while(consumer.read(event)){
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() - event.sentNs);
+        if(++received <= 2){
+            out << " [REMOTE VIEW " << viewerId << ", pid " << getpid()
+                << "] Counter state changed to = " << event.value << '\n';
+        }
+    }
+    out << " [REMOTE VIEW " << viewerId << "] received = " << received
+        << " ; lost to overruns = " << consumer.lost()
+        << " ; p50 <= " << histogram.percentile(0.50) << " ns"
+        << " ; p99 <= " << histogram.percentile(0.99) << " ns\n";
+    histogram.print(out);
+    std::cout << out.str() << std::flush; // one write, the viewers run concurrently
+    return EXIT_SUCCESS;
+}
+
+/** Wait until every viewer attached to the ring. Returns false as soon as a viewer exits
+    before attaching (it failed to start), which would otherwise leave the parent waiting forever. */
+bool waitForViewers(SharedRing& ring, std::vector<pid_t>& children)
+{
+    while(ring.attached.load() < children.size()){
+        for(auto it = children.begin(); it != children.end(); ++it){
+            if(waitpid(*it, nullptr, WNOHANG) == *it){
+                children.erase(it); // reaped
+                return false;
+            }
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+int main()
+{
+    constexpr int viewers = 2, increments = 50000;
+    const std::string shmName = "/designpatterns_counter_" + std::to_string(getpid());
+
+    auto shm = SharedMemory::create(shmName);
+
+    std::vector<pid_t> children;
+    // Stop and reap the viewers started so far; the segment is unlinked when shm goes away
+    auto abandon = [&](const std::string& what){
+        std::cerr << " [ERROR] " << what << '\n';
+        RingProducer{shm.ring()}.close();
+        for(const pid_t pid: children){ waitpid(pid, nullptr, 0); }
+        return EXIT_FAILURE;
+    };
+    for(int id = 1; id <= viewers; ++id){
+        const pid_t pid = fork();
+        if(pid < 0){ return abandon(std::string("fork: ") + std::strerror(errno)); }
+        if(pid == 0){
+            // Nothing may escape the child: _exit() skips the parent's destructors
+            int status = EXIT_FAILURE;
+            try {
+                status = runViewer(shmName, id);
+            } catch(const std::exception& e){
+                std::cerr << " [REMOTE VIEW " << id << "] " << e.what() << '\n';
+            }
+            _exit(status);
+        }
+        children.push_back(pid);
+    }
+    if(!waitForViewers(shm.ring(), children)){ return abandon("a viewer exited before attaching"); }
+
+    CounterModel          model;
+    SharedMemoryPublisher publisher{shm.ring()};
+    model.addObserver(&publisher);
+
+    std::cout << " -------------------------------- " << std::endl;
+    //Simulate increments, letting the viewers run in between
+    for(int i = 0; i < increments; ++i){
+        model.increment();
+        std::this_thread::yield();
+    }
+    publisher.close();
+
+    int failures = 0;
+    for(const pid_t pid: children){
+        int status = 0;
+        waitpid(pid, &status, 0);
+        failures += !(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,89 @@
+// Generation-checked handles over a dense array
+/*
+    Shared by the observer demos to keep their subscribers: subscribe and unsubscribe
+    in O(1), iterate without holes, and reject stale handles.
+*/
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+/** Handle returned when subscribing: slot index plus the generation of that slot.
+    Removing the observer bumps the slot generation, so a stale handle (already
+    removed, or whose slot was reused) simply does not match anymore.
+*/
+struct Subscription
+{
+    uint32_t index      = 0;
+    uint32_t generation = 0;
+};
+
+/** Slot map: values are kept in a dense array, so iterating has no holes to skip,
+    and slots translate a Subscription into a position in that array.
+    insert() and erase() are O(1); erase() moves the last value into the hole,
+    therefore it must not run while the dense array is being iterated.
+    Iteration follows insertion order only until the first erase(): the value moved
+    into the hole is visited earlier from then on, so observers kept here must not
+    rely on being notified in the order they subscribed.
+*/
+template<class T>
+class SlotMap
+{
+    struct Slot
+    {
+        uint32_t dense;
+        uint32_t generation;
+    };
+
+    std::vector<T>        m_values{};
+    std::vector<uint32_t> m_owners{};    // dense position -> slot index
+    std::vector<Slot>     m_slots{};
+    std::vector<uint32_t> m_freeSlots{};
+public:
+
+    Subscription insert(T value)
+    {
+        uint32_t index;
+        if(m_freeSlots.empty()){
+            index = static_cast<uint32_t>(m_slots.size());
+            m_slots.push_back({0, 1}); // generation 0 is never valid
+        } else {
+            index = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        m_slots[index].dense = static_cast<uint32_t>(m_values.size());
+        m_values.push_back(std::move(value));
+        m_owners.push_back(index);
+        return {index, m_slots[index].generation};
+    }
+
+    bool contains(Subscription handle) const
+    {
+        return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation;
+    }
+
+    /** Returns false, and does nothing, for a stale handle.
+        The last value takes the place of the erased one (swap-remove). */
+    bool erase(Subscription handle)
+    {
+        if(!contains(handle)){ return false; }
+        Slot& slot = m_slots[handle.index];
+        const uint32_t last = static_cast<uint32_t>(m_values.size() - 1);
+        if(slot.dense != last){
+            m_values[slot.dense] = std::move(m_values[last]);
+            m_owners[slot.dense] = m_owners[last];
+            m_slots[m_owners[slot.dense]].dense = slot.dense;
+        }
+        m_values.pop_back();
+        m_owners.pop_back();
+        ++slot.generation;
+        m_freeSlots.push_back(handle.index);
+        return true;
+    }
+
+    size_t size() const { return m_values.size(); }
+    auto begin() const { return m_values.begin(); }
+    auto end()   const { return m_values.end(); }
+};
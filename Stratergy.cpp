@@ -17,30 +17,58 @@ Concrete strategy.
 #include <iostream>
 #include <string>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <span>
+#include <variant>
+#include <optional>
+#include <cmath>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <condition_variable>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+#include <filesystem>
+#include <bit>
+#include <stdexcept>
+#include <cstring>
+#include <cassert>
+#include <system_error>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "AsyncLog.hpp"
+#include "Trace.hpp"
+#include "AllocCounter.hpp"
+#include "EpochReclaim.hpp"
+
+//--------------Floating point contraction--------------------//
+// The kernels below promise the same bits as the scalar a * x + b * y + c, which only holds
+// if the compiler does not fuse that expression into an FMA. GCC does by default in GNU mode
+// (-ffp-contract=fast) once -march allows FMA, and Clang within a statement. Switched off for
+// every function defined in this file; building with -ffp-contract=off does the same.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
 
 //--------------Logging--------------------//
-template <typename ...T> //variadic template
-void LOGI(T&&... args) //rvalue ref
-{
-    std::cout<<"[INFO]";
-    //warning: fold-expressions only available with '-std=c++17' or '-std=gnu++17'
-    ((std::cout << args), ...); 
-    std::cout<<'\n';
-}
-
-template <typename ...T> //variadic template
-void LOGT(T&&... args) //rvalue ref
-{
-   // std::cerr<<"[TRACE]";
-    //warning: fold-expressions only available with '-std=c++17' or '-std=gnu++17'
-  //  ((std::cerr << args), ...); 
-  //  std::cerr<<'\n';
-
-    std::cout<<"[TRACE]";
-    //warning: fold-expressions only available with '-std=c++17' or '-std=gnu++17'
-    ((std::cout << args), ...); 
-    std::cout<<'\n';
-}
+// Deferred to the background thread of AsyncLog.hpp; build with -DALOG_MIN_LEVEL=2
+// to compile the trace calls out of the constructors and destructors.
+#define LOGI(...) ALOG(::alog::Level::Info,  "[INFO]",  __VA_ARGS__)
+#define LOGT(...) ALOG(::alog::Level::Trace, "[TRACE]", __VA_ARGS__)
 //-----------------------------------------//
 // Strategy interface 
 struct IStrategy{
@@ -49,6 +77,16 @@ struct IStrategy{
 
   // Essential: Algorithm encapsulated by strategy object 
   virtual auto compute(double x, double y) const -> double = 0; 
+
+  // Batched form: out[i] = compute(xs[i], ys[i]) for every i.
+  // The default loops over the scalar call; strategies override it with vectorized kernels.
+  virtual auto compute(std::span<const double> xs, std::span<const double> ys,
+                       std::span<double> out) const -> void {
+    checkBatch(xs, ys, out);
+    for(size_t i = 0; i < out.size(); ++i){
+      out[i] = compute(xs[i], ys[i]);
+    }
+  }
   
   // Optional: Provides strategy metadata 
   virtual auto name() const -> const std::string = 0;
@@ -56,44 +94,395 @@ struct IStrategy{
   // Clone this object (Note: This is a virtual constructor)
   virtual auto clone() const -> IStrategy* = 0;
 
+protected:
+  static auto checkBatch(std::span<const double> xs, std::span<const double> ys,
+                         std::span<double> out) -> void {
+    if(xs.size() != out.size() || ys.size() != out.size()){
+      throw std::invalid_argument("compute: xs, ys and out must have the same size");
+    }
+  }
+};
+
+//--------------Batched kernels--------------------//
+// Each kernel processes the longest prefix that fills whole vector registers and returns
+// its length; the caller finishes the tail with the scalar expression. Unaligned loads,
+// and no FMA: the vector lanes round exactly like the (uncontracted) scalar code.
+#if defined(__x86_64__)
+inline auto hasAvx2() -> bool {
+  static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+  return supported;
+}
+
+[[gnu::target("avx2")]] inline auto addAvx2(const double* x, const double* y, double* out, size_t n) -> size_t {
+  size_t i = 0;
+  for(; i + 4 <= n; i += 4){
+    _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+  }
+  return i;
+}
+inline auto addSse2(const double* x, const double* y, double* out, size_t n) -> size_t {
+  size_t i = 0;
+  for(; i + 2 <= n; i += 2){
+    _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+  }
+  return i;
+}
+
+[[gnu::target("avx2")]] inline auto mulAvx2(const double* x, const double* y, double* out, size_t n) -> size_t {
+  size_t i = 0;
+  for(; i + 4 <= n; i += 4){
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+  }
+  return i;
+}
+inline auto mulSse2(const double* x, const double* y, double* out, size_t n) -> size_t {
+  size_t i = 0;
+  for(; i + 2 <= n; i += 2){
+    _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+  }
+  return i;
+}
+
+// a * x + b * y + c, evaluated as (a * x + b * y) + c like the scalar expression
+[[gnu::target("avx2")]] inline auto linearAvx2(double a, double b, double c,
+    const double* x, const double* y, double* out, size_t n) -> size_t {
+  const __m256d va = _mm256_set1_pd(a), vb = _mm256_set1_pd(b), vc = _mm256_set1_pd(c);
+  size_t i = 0;
+  for(; i + 4 <= n; i += 4){
+    const __m256d ax = _mm256_mul_pd(va, _mm256_loadu_pd(x + i));
+    const __m256d by = _mm256_mul_pd(vb, _mm256_loadu_pd(y + i));
+    _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_add_pd(ax, by), vc));
+  }
+  return i;
+}
+inline auto linearSse2(double a, double b, double c,
+    const double* x, const double* y, double* out, size_t n) -> size_t {
+  const __m128d va = _mm_set1_pd(a), vb = _mm_set1_pd(b), vc = _mm_set1_pd(c);
+  size_t i = 0;
+  for(; i + 2 <= n; i += 2){
+    const __m128d ax = _mm_mul_pd(va, _mm_loadu_pd(x + i));
+    const __m128d by = _mm_mul_pd(vb, _mm_loadu_pd(y + i));
+    _mm_storeu_pd(out + i, _mm_add_pd(_mm_add_pd(ax, by), vc));
+  }
+  return i;
+}
+#endif
+//-----------------------------------------//
+
+//Strategy holder:
+//Owns one strategy with value semantics (copying the holder copies the strategy).
+//Strategies up to Capacity bytes, suitably aligned and nothrow movable, are constructed in
+//the holder itself; larger ones are allocated on the heap. Pointers handed over with
+//adopt() (e.g. the result of clone()) stay where they are and are copied with clone().
+//The counters tell how many strategies were stored inline and how many heap allocations
+//holders made themselves.
+struct StrategyHolderStats{
+  static inline std::atomic<size_t> inlineStores{0};
+  static inline std::atomic<size_t> heapAllocations{0};
+};
+
+template<size_t Capacity = 64>
+class StrategyHolder{
+public:
+  template<typename S>
+  static constexpr bool fitsInline = sizeof(S) <= Capacity && alignof(S) <= alignof(std::max_align_t)
+                                     && std::is_nothrow_move_constructible_v<S>;
+
+  StrategyHolder() = default;
+  StrategyHolder(const StrategyHolder& other) { copyFrom(other); }
+  StrategyHolder(StrategyHolder&& other) noexcept { moveFrom(other); }
+  StrategyHolder& operator=(const StrategyHolder& other) {
+    if(this != &other){ reset(); copyFrom(other); }
+    return *this;
+  }
+  StrategyHolder& operator=(StrategyHolder&& other) noexcept {
+    if(this != &other){ reset(); moveFrom(other); }
+    return *this;
+  }
+  ~StrategyHolder(){ reset(); }
+
+  // Replace the strategy by a new S built from args (which must not refer to the current one)
+  template<typename S, typename... Args>
+  auto emplace(Args&&... args) -> S& {
+    reset();
+    if constexpr(fitsInline<S>){
+      strategy = ::new (static_cast<void*>(buffer)) S(std::forward<Args>(args)...);
+      ops = &inlineOps<S>;
+      StrategyHolderStats::inlineStores.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      strategy = new S(std::forward<Args>(args)...);
+      ops = &heapOps<S>;
+      StrategyHolderStats::heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return *static_cast<S*>(strategy);
+  }
+
+  // Take ownership of a heap-allocated strategy
+  auto adopt(IStrategy* s) -> void {
+    reset();
+    if(s != nullptr){
+      strategy = s;
+      ops = &adoptedOps;
+    }
+  }
+
+  auto reset() -> void {
+    if(strategy != nullptr){
+      ops->destroy(strategy);
+      strategy = nullptr;
+      ops = nullptr;
+    }
+  }
+
+  auto get() const -> IStrategy* { return strategy; }
+  auto operator->() const -> IStrategy* { return strategy; }
+  explicit operator bool() const { return strategy != nullptr; }
+  auto isInline() const -> bool { return ops != nullptr && ops->isInline; }
+
+private:
+  struct Ops{
+    IStrategy* (*copy)(const IStrategy* from, void* buffer);
+    IStrategy* (*move)(IStrategy* from, void* buffer);   // inline storage only
+    void       (*destroy)(IStrategy* s);
+    bool       isInline;
+  };
+
+  template<typename S>
+  static constexpr Ops inlineOps{
+    [](const IStrategy* from, void* buffer) -> IStrategy* {
+      return ::new (buffer) S(*static_cast<const S*>(from));
+    },
+    [](IStrategy* from, void* buffer) -> IStrategy* {
+      S* moved = ::new (buffer) S(std::move(*static_cast<S*>(from)));
+      static_cast<S*>(from)->~S();
+      return moved;
+    },
+    [](IStrategy* s){ static_cast<S*>(s)->~S(); },
+    true
+  };
+
+  template<typename S>
+  static constexpr Ops heapOps{
+    [](const IStrategy* from, void*) -> IStrategy* {
+      StrategyHolderStats::heapAllocations.fetch_add(1, std::memory_order_relaxed);
+      return new S(*static_cast<const S*>(from));
+    },
+    nullptr,
+    [](IStrategy* s){ delete static_cast<S*>(s); },
+    false
+  };
+
+  static constexpr Ops adoptedOps{
+    [](const IStrategy* from, void*) -> IStrategy* { return from->clone(); },
+    nullptr,
+    [](IStrategy* s){ delete s; },
+    false
+  };
+
+  auto copyFrom(const StrategyHolder& other) -> void {
+    if(other.strategy != nullptr){
+      strategy = other.ops->copy(other.strategy, buffer);
+      ops = other.ops;
+    }
+  }
+
+  auto moveFrom(StrategyHolder& other) noexcept -> void {
+    if(other.strategy == nullptr){ return; }
+    strategy = other.ops->isInline ? other.ops->move(other.strategy, buffer) : other.strategy;
+    ops = other.ops;
+    other.strategy = nullptr;
+    other.ops = nullptr;
+  }
+
+  alignas(std::max_align_t) std::byte buffer[Capacity];
+  IStrategy*                          strategy = nullptr;
+  const Ops*                          ops = nullptr;
 };
 
+//Work-stealing pool:
+//parallelFor() splits [0, n) in chunks and gives every worker (the calling thread is worker 0)
+//a contiguous share of them in its own deque. A worker takes its chunks from the front, in
+//address order; a worker whose deque is empty steals from the back of another one's, so
+//uneven chunks or a descheduled thread do not leave the others idle.
+//The chunks are the same for the same n and chunk size whatever the timing: a body whose
+//elements are independent produces the same results as a serial loop.
+//The body must not throw. One parallelFor() runs at a time, further calls wait.
+class WorkStealingPool{
+public:
+  static constexpr size_t DefaultChunk = 1 << 16;
+
+  explicit WorkStealingPool(unsigned threadCount = std::thread::hardware_concurrency())
+    : workerCount{std::max(1u, threadCount)}, workers{new Worker[workerCount]} {
+    for(unsigned i = 1; i < workerCount; ++i){
+      threads.emplace_back([this, i]{ run(i); });
+    }
+  }
+
+  ~WorkStealingPool(){
+    {
+      std::lock_guard<std::mutex> lock{wakeMutex};
+      stop = true;
+    }
+    wakeup.notify_all();
+    for(auto& t: threads){ t.join(); }
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  // Calls body(begin, end) over chunks covering [0, n), and returns when all are done
+  template<typename F>
+  auto parallelFor(size_t n, size_t chunk, F&& body) -> void {
+    if(n == 0){ return; }
+    std::lock_guard<std::mutex> job{jobMutex};
+    chunk = std::max<size_t>(1, chunk);
+    const size_t chunks = (n + chunk - 1) / chunk;
+    // Read by the workers after they took a range, under the deque mutex
+    jobBody = [](void* context, size_t begin, size_t end){ (*static_cast<std::remove_reference_t<F>*>(context))(begin, end); };
+    jobContext = &body;
+    remaining.store(n, std::memory_order_relaxed);
+    for(unsigned w = 0; w < workerCount; ++w){
+      std::lock_guard<std::mutex> lock{workers[w].mutex};
+      for(size_t c = chunks * w / workerCount; c < chunks * (w + 1) / workerCount; ++c){
+        workers[w].ranges.push_back({c * chunk, std::min(n, (c + 1) * chunk)});
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock{wakeMutex};
+      ++generation;
+    }
+    wakeup.notify_all();
+    work(0);
+    while(remaining.load(std::memory_order_acquire) != 0){ std::this_thread::yield(); }
+  }
+
+  auto size() const -> unsigned { return workerCount; }
+
+  /** Chunks taken from another worker's deque since the pool was created */
+  auto steals() const -> size_t { return stolen.load(std::memory_order_relaxed); }
+
+private:
+  struct Range{ size_t begin, end; };
+
+  struct alignas(64) Worker{
+    std::mutex        mutex;
+    std::deque<Range> ranges;
+  };
+
+  auto run(unsigned self) -> void {
+    std::uint64_t seen = 0;
+    for(;;){
+      {
+        std::unique_lock<std::mutex> lock{wakeMutex};
+        wakeup.wait(lock, [&]{ return stop || generation != seen; });
+        if(stop){ return; }
+        seen = generation;
+      }
+      work(self);
+    }
+  }
+
+  auto work(unsigned self) -> void {
+    Range range;
+    while(take(self, range)){
+      jobBody(jobContext, range.begin, range.end);
+      remaining.fetch_sub(range.end - range.begin, std::memory_order_release);
+    }
+  }
+
+  auto take(unsigned self, Range& range) -> bool {
+    {
+      Worker& own = workers[self];
+      std::lock_guard<std::mutex> lock{own.mutex};
+      if(!own.ranges.empty()){
+        range = own.ranges.front();
+        own.ranges.pop_front();
+        return true;
+      }
+    }
+    for(unsigned i = 1; i < workerCount; ++i){
+      Worker& victim = workers[(self + i) % workerCount];
+      std::lock_guard<std::mutex> lock{victim.mutex};
+      if(!victim.ranges.empty()){
+        range = victim.ranges.back();
+        victim.ranges.pop_back();
+        stolen.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const unsigned              workerCount;
+  std::unique_ptr<Worker[]>   workers;
+  std::vector<std::thread>    threads;
+  std::mutex                  jobMutex;
+  void (*jobBody)(void*, size_t, size_t) = nullptr;
+  void*                       jobContext = nullptr;
+  std::atomic<size_t>         remaining{0};
+  std::atomic<size_t>         stolen{0};
+  std::mutex                  wakeMutex;
+  std::condition_variable     wakeup;
+  std::uint64_t               generation = 0;
+  bool                        stop = false;
+};
+
+// Column of n doubles whose pages are first written by the pool with the same chunks a
+// parallel compute() uses: on a NUMA machine each page lands on the node of the worker
+// that will write it again (the kernel places a page where it is first touched).
+inline auto allocateColumn(WorkStealingPool& pool, size_t n, size_t chunk = WorkStealingPool::DefaultChunk)
+  -> std::unique_ptr<double[]> {
+  auto column = std::make_unique_for_overwrite<double[]>(n);
+  pool.parallelFor(n, chunk, [&](size_t begin, size_t end){
+    std::fill(column.get() + begin, column.get() + end, 0.0);
+  });
+  return column;
+}
+
 //Context Class:
 //Selects and switch the strategy (aka algorithm).
 
 class Context{
 private: 
-  std::unique_ptr<IStrategy> strategy;
+  StrategyHolder<> strategy;
 
 public:
-  Context()
-    : strategy{nullptr} { 
+  Context() { 
         LOGT("Context => Constructed");
     }
 
-  Context(IStrategy* s)
-    : strategy{s} { 
+  Context(IStrategy* s) { 
+        strategy.adopt(s);
         LOGT("Context => Constructed using *");
     }
 
-  Context(const IStrategy& s)
-    : strategy{s.clone()} {
+  Context(const IStrategy& s) {
+        strategy.adopt(s.clone());
         LOGT("Context => Constructed using clone");
      }
 
   auto setStrategy(IStrategy* s){
     LOGT("Context => setStrategy *");
-    strategy.reset(s);// deletes managed object, acquires new pointer
+    strategy.adopt(s);// deletes managed object, acquires new pointer
   }
 
   auto setStrategy(const IStrategy& s){
     LOGT("Context => setStrategy const&");
-    strategy.reset(s.clone());
+    strategy.adopt(s.clone());
   }  
 
+  // Move a strategy in: stored inside the context when it fits, no clone()
+  template<typename S>
+    requires (std::is_base_of_v<IStrategy, S> && !std::is_lvalue_reference_v<S>)
+  auto setStrategy(S&& s){
+    LOGT("Context => setStrategy &&");
+    strategy.emplace<S>(std::move(s));
+  }
+
   auto compute(double x, double y) -> void {
-    if(nullptr == strategy){
-        std::runtime_error("Error: strategy not set");
+    TRACE_SCOPE("Context::compute");
+    if(!strategy){
+        throw std::runtime_error("Error: strategy not set");
     }
       
     double result = strategy->compute(x, y);
@@ -105,6 +494,35 @@ public:
     );
   }
 
+  // Batched form: one call for whole columns, see IStrategy::compute
+  auto compute(std::span<const double> xs, std::span<const double> ys, std::span<double> out) -> void {
+    TRACE_SCOPE("Context::compute batched");
+    if(!strategy){
+        throw std::runtime_error("Error: strategy not set");
+    }
+    strategy->compute(xs, ys, out);
+  }
+
+  // Parallel form: each chunk of the columns is a batched compute on a pool worker.
+  // Same results as the batched form, the elements being independent.
+  auto compute(WorkStealingPool& pool, std::span<const double> xs, std::span<const double> ys,
+               std::span<double> out, size_t chunk = WorkStealingPool::DefaultChunk) -> void {
+    TRACE_SCOPE("Context::compute parallel");
+    if(!strategy){
+        throw std::runtime_error("Error: strategy not set");
+    }
+    if(xs.size() != out.size() || ys.size() != out.size()){
+      throw std::invalid_argument("compute: xs, ys and out must have the same size");
+    }
+    const IStrategy& s = *strategy.get();
+    pool.parallelFor(out.size(), chunk, [&](size_t begin, size_t end){
+      TRACE_SCOPE("parallel chunk");
+      s.compute(xs.subspan(begin, end - begin), ys.subspan(begin, end - begin), out.subspan(begin, end - begin));
+    });
+  }
+
+  auto isInline() const -> bool { return strategy.isInline(); }
+
     ~Context(){
        LOGT("Context => Destructed");
    }
@@ -122,6 +540,17 @@ public:
     return x + y;
   }
 
+  auto compute(std::span<const double> xs, std::span<const double> ys,
+               std::span<double> out) const -> void override{
+    checkBatch(xs, ys, out);
+    size_t i = 0;
+#if defined(__x86_64__)
+    i = hasAvx2() ? addAvx2(xs.data(), ys.data(), out.data(), out.size())
+                  : addSse2(xs.data(), ys.data(), out.data(), out.size());
+#endif
+    for(; i < out.size(); ++i){ out[i] = xs[i] + ys[i]; }
+  }
+
   auto clone() const -> IStrategy* {
     LOGT("AddStrategy => I was cloned");
     return new AddStrategy(*this);
@@ -140,8 +569,20 @@ public:
   }  
 
   auto compute(double x, double y) const -> double override{
-    return x + y;
+    return x * y;
+  }
+
+  auto compute(std::span<const double> xs, std::span<const double> ys,
+               std::span<double> out) const -> void override{
+    checkBatch(xs, ys, out);
+    size_t i = 0;
+#if defined(__x86_64__)
+    i = hasAvx2() ? mulAvx2(xs.data(), ys.data(), out.data(), out.size())
+                  : mulSse2(xs.data(), ys.data(), out.data(), out.size());
+#endif
+    for(; i < out.size(); ++i){ out[i] = xs[i] * ys[i]; }
   }
+
   auto clone() const -> IStrategy* {
     LOGT("MulStrategy => I was cloned");
     return new MulStrategy(*this);
@@ -157,6 +598,12 @@ struct LinearCombStrategy: public IStrategy {
       LOGT("LinearCombStrategy => Constructed");
   }
 
+  // The destructor below would otherwise suppress the implicit move operations
+  LinearCombStrategy(const LinearCombStrategy&) = default;
+  LinearCombStrategy(LinearCombStrategy&&) noexcept = default;
+  auto operator=(const LinearCombStrategy&) -> LinearCombStrategy& = default;
+  auto operator=(LinearCombStrategy&&) noexcept -> LinearCombStrategy& = default;
+
   auto name() const -> const std::string override{
     return "Linear combination a * x + b * y + c";
   }
@@ -165,6 +612,17 @@ struct LinearCombStrategy: public IStrategy {
     return a * x + b * y + c;
   }
 
+  auto compute(std::span<const double> xs, std::span<const double> ys,
+               std::span<double> out) const -> void override{
+    checkBatch(xs, ys, out);
+    size_t i = 0;
+#if defined(__x86_64__)
+    i = hasAvx2() ? linearAvx2(a, b, c, xs.data(), ys.data(), out.data(), out.size())
+                  : linearSse2(a, b, c, xs.data(), ys.data(), out.data(), out.size());
+#endif
+    for(; i < out.size(); ++i){ out[i] = a * xs[i] + b * ys[i] + c; }
+  }
+
   auto clone() const -> IStrategy* {
     LOGT("LinearCombStrategy => I was cloned");
     return new LinearCombStrategy(*this);
@@ -175,7 +633,1205 @@ struct LinearCombStrategy: public IStrategy {
    }
 };
 
-int main(){
+//Expression program:
+//A formula over x and y compiled once into a register bytecode. Registers are never reused
+//(each instruction writes a new one), x and y are registers 0 and 1, and the constants of
+//the formula are preloaded registers. Operations on constants only are folded while parsing,
+//as are the exact identities e * 1, 1 * e, e / 1 and e - 0.
+//A formula computing a * x + b * y + c (the common case) runs the LinearCombStrategy kernels.
+//Grammar: + - * / ^ (right associative), unary minus, parentheses, numbers,
+//         sqrt abs sin cos exp log (one argument), min max (two arguments).
+class ExpressionProgram{
+public:
+  enum class Op: std::uint8_t { Add, Sub, Mul, Div, Pow, Min, Max, Neg, Sqrt, Abs, Sin, Cos, Exp, Log };
+
+  struct Instruction {
+    Op           op;
+    std::uint8_t dst, a, b; // b is unused by the one-argument operations
+  };
+
+  static constexpr int X = 0, Y = 1;
+  static constexpr int MaxRegisters = 256;
+  static constexpr size_t Block = 256;  // pairs per instruction in the batched form
+
+  // Throws std::invalid_argument on a malformed formula
+  static auto compile(const std::string& formula) -> ExpressionProgram;
+
+  auto evaluate(double x, double y) const -> double {
+    if(affine){ return affine->a * x + affine->b * y + affine->c; }
+    double r[MaxRegisters];
+    r[X] = x;
+    r[Y] = y;
+    for(const auto& [reg, value]: constants){ r[reg] = value; }
+    for(const auto& in: code){ r[in.dst] = apply(in.op, r[in.a], r[in.b]); }
+    return r[result];
+  }
+
+  // Each instruction runs over a whole block of pairs: one dispatch per block, and
+  // loops the compiler vectorizes. The last partial block is evaluated pair by pair.
+  // The registers live in a buffer of the calling thread, allocated once.
+  auto evaluate(std::span<const double> xs, std::span<const double> ys, std::span<double> out) const -> void {
+    const size_t n = out.size(), full = n - n % Block;
+    if(affine){
+      const auto [a, b, c] = *affine;
+      size_t i = 0;
+#if defined(__x86_64__)
+      i = hasAvx2() ? linearAvx2(a, b, c, xs.data(), ys.data(), out.data(), n)
+                    : linearSse2(a, b, c, xs.data(), ys.data(), out.data(), n);
+#endif
+      for(; i < n; ++i){ out[i] = a * xs[i] + b * ys[i] + c; }
+      return;
+    }
+    thread_local std::vector<double> scratch;
+    if(scratch.size() < registers * Block){ scratch.resize(registers * Block); }
+    double* r = scratch.data();
+    for(const auto& [reg, value]: constants){
+      std::fill_n(&r[reg * Block], Block, value);
+    }
+    for(size_t base = 0; base < full; base += Block){
+      auto reg = [&](int i) -> double* {
+        if(i == X){ return const_cast<double*>(xs.data() + base); } // read only
+        if(i == Y){ return const_cast<double*>(ys.data() + base); }
+        return &r[i * Block];
+      };
+      for(const auto& in: code){
+        double* d = reg(in.dst);
+        const double* a = reg(in.a);
+        const double* b = reg(in.b);
+        switch(in.op){
+        case Op::Add:  each(d, a, b, [](double u, double v){ return u + v; }); break;
+        case Op::Sub:  each(d, a, b, [](double u, double v){ return u - v; }); break;
+        case Op::Mul:  each(d, a, b, [](double u, double v){ return u * v; }); break;
+        case Op::Div:  each(d, a, b, [](double u, double v){ return u / v; }); break;
+        case Op::Neg:  each(d, a, b, [](double u, double){ return -u; }); break;
+        default:       each(d, a, b, [op = in.op](double u, double v){ return apply(op, u, v); }); break;
+        }
+      }
+      std::copy_n(reg(result), Block, out.data() + base);
+    }
+    for(size_t i = full; i < n; ++i){ out[i] = evaluate(xs[i], ys[i]); }
+  }
+
+  auto size() const -> size_t { return code.size(); }
+
+private:
+  static auto apply(Op op, double a, double b) -> double {
+    switch(op){
+    case Op::Add:  return a + b;
+    case Op::Sub:  return a - b;
+    case Op::Mul:  return a * b;
+    case Op::Div:  return a / b;
+    case Op::Pow:  return std::pow(a, b);
+    case Op::Min:  return b < a ? b : a;
+    case Op::Max:  return a < b ? b : a;
+    case Op::Neg:  return -a;
+    case Op::Sqrt: return std::sqrt(a);
+    case Op::Abs:  return std::fabs(a);
+    case Op::Sin:  return std::sin(a);
+    case Op::Cos:  return std::cos(a);
+    case Op::Exp:  return std::exp(a);
+    case Op::Log:  return std::log(a);
+    }
+    return 0;
+  }
+
+  template<typename F>
+  static auto each(double* __restrict d, const double* __restrict a, const double* __restrict b, F f) -> void {
+    for(size_t i = 0; i < Block; ++i){ d[i] = f(a[i], b[i]); }
+  }
+
+  // Result of parsing a sub-expression: a constant not materialized yet, or a register
+  struct Operand {
+    bool   isConstant;
+    double value;
+    int    reg;
+  };
+
+  struct Affine {
+    double a, b, c;
+  };
+
+  class Parser;
+
+  std::vector<Instruction>           code;
+  std::vector<std::pair<int, double>> constants;
+  int                                result = X;
+  int                                registers = 2;
+  std::optional<Affine>              affine;     // set when the program computes a * x + b * y + c
+};
+
+class ExpressionProgram::Parser{
+public:
+  explicit Parser(const std::string& formula): text(formula) { }
+
+  auto run() -> ExpressionProgram {
+    const Operand e = expression();
+    skipSpaces();
+    if(pos != text.size()){ fail("unexpected character"); }
+    program.result = materialize(e);
+    program.registers = next;
+    program.affine = findAffine();
+    return std::move(program);
+  }
+
+private:
+  using Term = std::pair<int, double>; // k * x or k * y: variable register and k
+
+  //Affine form:
+  //Recognizes (k1 * x + k2 * y) + k3, in any operand order, with - instead of + and unary
+  //minus on the terms. Only shapes that round exactly like a * x + b * y + c qualify,
+  //so the fast path returns the same bits as the bytecode. This relies on the fast path
+  //not being contracted into an FMA, which the bytecode never is (see the top of the file).
+  auto findAffine() const -> std::optional<Affine> {
+    const Instruction* top = producer(program.result);
+    if(!top || (top->op != Op::Add && top->op != Op::Sub)){ return std::nullopt; }
+    auto combine = [&](int sumReg, int constantReg, double sign) -> std::optional<Affine> {
+      const auto c = constantOf(constantReg);
+      const auto ab = affineSum(sumReg);
+      if(!c || !ab){ return std::nullopt; }
+      return Affine{ab->first, ab->second, sign * *c};
+    };
+    if(auto found = combine(top->a, top->b, top->op == Op::Sub ? -1.0 : 1.0)){ return found; }
+    if(top->op == Op::Add){ return combine(top->b, top->a, 1.0); }
+    return std::nullopt;
+  }
+
+  // k1 * x + k2 * y or k1 * x - k2 * y, as (k1, k2) whatever the order of the terms
+  auto affineSum(int reg) const -> std::optional<std::pair<double, double>> {
+    const Instruction* in = producer(reg);
+    if(!in || (in->op != Op::Add && in->op != Op::Sub)){ return std::nullopt; }
+    auto first = affineTerm(in->a), second = affineTerm(in->b);
+    if(!first || !second || first->first == second->first){ return std::nullopt; }
+    if(in->op == Op::Sub){ second->second = -second->second; }
+    return first->first == X ? std::pair{first->second, second->second}
+                             : std::pair{second->second, first->second};
+  }
+
+  // x, y, k * x, x * k, -x and their y counterparts
+  auto affineTerm(int reg) const -> std::optional<Term> {
+    if(reg == X || reg == Y){ return Term{reg, 1.0}; }
+    const Instruction* in = producer(reg);
+    if(!in){ return std::nullopt; }
+    if(in->op == Op::Neg && (in->a == X || in->a == Y)){ return Term{in->a, -1.0}; }
+    if(in->op != Op::Mul){ return std::nullopt; }
+    if((in->b == X || in->b == Y) && constantOf(in->a)){ return Term{in->b, *constantOf(in->a)}; }
+    if((in->a == X || in->a == Y) && constantOf(in->b)){ return Term{in->a, *constantOf(in->b)}; }
+    return std::nullopt;
+  }
+
+  // Instruction writing the register, nullptr for x, y and the constants
+  auto producer(int reg) const -> const Instruction* {
+    for(const auto& in: program.code){
+      if(in.dst == reg){ return &in; }
+    }
+    return nullptr;
+  }
+
+  auto constantOf(int reg) const -> std::optional<double> {
+    for(const auto& [r, value]: program.constants){
+      if(r == reg){ return value; }
+    }
+    return std::nullopt;
+  }
+
+  auto expression() -> Operand {
+    Operand lhs = term();
+    for(;;){
+      if(accept('+')){ lhs = binary(Op::Add, lhs, term()); }
+      else if(accept('-')){ lhs = binary(Op::Sub, lhs, term()); }
+      else { return lhs; }
+    }
+  }
+
+  auto term() -> Operand {
+    Operand lhs = unary();
+    for(;;){
+      if(accept('*')){ lhs = binary(Op::Mul, lhs, unary()); }
+      else if(accept('/')){ lhs = binary(Op::Div, lhs, unary()); }
+      else { return lhs; }
+    }
+  }
+
+  auto unary() -> Operand {
+    if(accept('-')){ return unaryOp(Op::Neg, unary()); }
+    return power();
+  }
+
+  auto power() -> Operand {
+    const Operand base = primary();
+    if(accept('^')){ return binary(Op::Pow, base, unary()); }
+    return base;
+  }
+
+  auto primary() -> Operand {
+    skipSpaces();
+    if(accept('(')){
+      const Operand e = expression();
+      expect(')');
+      return e;
+    }
+    if(pos < text.size() && (std::isdigit(static_cast<unsigned char>(text[pos])) || text[pos] == '.')){
+      double value = 0;
+      const auto [end, error] = std::from_chars(text.data() + pos, text.data() + text.size(), value);
+      if(error != std::errc{}){ fail("malformed number"); }
+      pos = end - text.data();
+      return {true, value, -1};
+    }
+    const size_t start = pos;
+    while(pos < text.size() && std::isalpha(static_cast<unsigned char>(text[pos]))){ ++pos; }
+    const std::string name = text.substr(start, pos - start);
+    if(name.empty()){ fail("expected a number, x, y, a function or '('"); }
+    if(name == "x"){ return {false, 0, X}; }
+    if(name == "y"){ return {false, 0, Y}; }
+
+    static const std::pair<const char*, Op> functions[] = {
+      {"sqrt", Op::Sqrt}, {"abs", Op::Abs}, {"sin", Op::Sin}, {"cos", Op::Cos},
+      {"exp", Op::Exp}, {"log", Op::Log}, {"min", Op::Min}, {"max", Op::Max}
+    };
+    for(const auto& [fname, op]: functions){
+      if(name != fname){ continue; }
+      expect('(');
+      const Operand first = expression();
+      if(op == Op::Min || op == Op::Max){
+        expect(',');
+        const Operand second = expression();
+        expect(')');
+        return binary(op, first, second);
+      }
+      expect(')');
+      return unaryOp(op, first);
+    }
+    pos = start;
+    fail("unknown name '" + name + "'");
+  }
+
+  auto binary(Op op, const Operand& a, const Operand& b) -> Operand {
+    if(a.isConstant && b.isConstant){ return {true, apply(op, a.value, b.value), -1}; }
+    if((op == Op::Mul || op == Op::Div) && b.isConstant && b.value == 1){ return a; }
+    if(op == Op::Mul && a.isConstant && a.value == 1){ return b; }
+    if(op == Op::Sub && b.isConstant && b.value == 0){ return a; }
+    const int ra = materialize(a), rb = materialize(b);
+    return emit(op, ra, rb);
+  }
+
+  auto unaryOp(Op op, const Operand& a) -> Operand {
+    if(a.isConstant){ return {true, apply(op, a.value, 0), -1}; }
+    return emit(op, a.reg, a.reg);
+  }
+
+  auto emit(Op op, int a, int b) -> Operand {
+    const int dst = allocate();
+    program.code.push_back({op, static_cast<std::uint8_t>(dst), static_cast<std::uint8_t>(a),
+                            static_cast<std::uint8_t>(b)});
+    return {false, 0, dst};
+  }
+
+  // Constants get a preloaded register, shared by equal constants
+  auto materialize(const Operand& e) -> int {
+    if(!e.isConstant){ return e.reg; }
+    for(const auto& [reg, value]: program.constants){
+      if(std::memcmp(&value, &e.value, sizeof(double)) == 0){ return reg; }
+    }
+    const int reg = allocate();
+    program.constants.push_back({reg, e.value});
+    return reg;
+  }
+
+  auto allocate() -> int {
+    if(next == MaxRegisters){ fail("formula too long"); }
+    return next++;
+  }
+
+  auto skipSpaces() -> void {
+    while(pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))){ ++pos; }
+  }
+  auto accept(char c) -> bool {
+    skipSpaces();
+    if(pos < text.size() && text[pos] == c){ ++pos; return true; }
+    return false;
+  }
+  auto expect(char c) -> void {
+    if(!accept(c)){ fail(std::string("expected '") + c + "'"); }
+  }
+  [[noreturn]] auto fail(const std::string& what) const -> void {
+    throw std::invalid_argument("expression: " + what + " at position " + std::to_string(pos)
+                                + " in \"" + text + "\"");
+  }
+
+  const std::string& text;
+  size_t             pos = 0;
+  int                next = 2; // registers 0 and 1 hold x and y
+  ExpressionProgram  program;
+};
+
+inline auto ExpressionProgram::compile(const std::string& formula) -> ExpressionProgram {
+  Parser parser{formula};
+  return parser.run();
+}
+
+//Expression: a strategy written as a formula, no recompilation needed
+//   ExpressionStrategy{"5 * x + 3 * y + 4"} computes what LinearCombStrategy{5, 3, 4} does
+struct ExpressionStrategy: public IStrategy {
+  std::string       formula;
+  ExpressionProgram program;
+
+  explicit ExpressionStrategy(const std::string& formula)
+    : formula(formula), program(ExpressionProgram::compile(formula))
+  {
+      LOGT("ExpressionStrategy => Constructed");
+  }
+
+  // Moved, not deep-copied, into a Context: the destructor below suppresses the implicit moves
+  ExpressionStrategy(const ExpressionStrategy&) = default;
+  ExpressionStrategy(ExpressionStrategy&&) noexcept = default;
+  auto operator=(const ExpressionStrategy&) -> ExpressionStrategy& = default;
+  auto operator=(ExpressionStrategy&&) noexcept -> ExpressionStrategy& = default;
+
+  auto name() const -> const std::string override{
+    return formula;
+  }
+
+  auto compute(double x, double y) const -> double override{
+    return program.evaluate(x, y);
+  }
+
+  auto compute(std::span<const double> xs, std::span<const double> ys,
+               std::span<double> out) const -> void override{
+    checkBatch(xs, ys, out);
+    program.evaluate(xs, ys, out);
+  }
+
+  auto clone() const -> IStrategy* {
+    LOGT("ExpressionStrategy => I was cloned");
+    return new ExpressionStrategy(*this);
+  }
+
+    ~ExpressionStrategy(){
+       LOGT("ExpressionStrategy => Destructed");
+   }
+};
+
+//Variant Context:
+//Same role as Context for the built-in strategies, stored inline in a std::variant:
+//setStrategy() does not allocate, and compute() switches on the variant index and calls
+//the strategy with a qualified, non-virtual call the compiler can inline.
+//Any other strategy is still accepted and goes through IStrategy (cloned or adopted).
+class VariantContext{
+public:
+  using Strategy = std::variant<std::monostate, AddStrategy, MulStrategy, LinearCombStrategy,
+                                std::unique_ptr<IStrategy>>;
+
+  VariantContext() = default;
+
+  // Constrained so that copying or moving a VariantContext never picks this constructor
+  template<typename S>
+    requires (!std::is_same_v<std::remove_cvref_t<S>, VariantContext>)
+  explicit VariantContext(S&& s) { setStrategy(std::forward<S>(s)); }
+
+  // Built-in strategies are stored by value, other ones are cloned
+  template<typename S>
+    requires std::is_base_of_v<IStrategy, std::decay_t<S>>
+  auto setStrategy(S&& s) -> void {
+    using T = std::decay_t<S>;
+    if constexpr(std::is_same_v<T, AddStrategy> || std::is_same_v<T, MulStrategy>
+                 || std::is_same_v<T, LinearCombStrategy>){
+      strategy.emplace<T>(std::forward<S>(s));
+    } else {
+      strategy.emplace<std::unique_ptr<IStrategy>>(s.clone());
+    }
+  }
+
+  // Takes ownership, like Context::setStrategy(IStrategy*)
+  auto setStrategy(std::unique_ptr<IStrategy> s) -> void {
+    strategy.emplace<std::unique_ptr<IStrategy>>(std::move(s));
+  }
+
+  auto compute(double x, double y) const -> double {
+    return dispatch([&](const auto& s) -> double {
+      using S = std::decay_t<decltype(s)>;
+      if constexpr(std::is_same_v<S, std::monostate>){
+        throw std::runtime_error("Error: strategy not set");
+      } else if constexpr(std::is_same_v<S, std::unique_ptr<IStrategy>>){
+        if(nullptr == s){ throw std::runtime_error("Error: strategy not set"); }
+        return s->compute(x, y);
+      } else {
+        return s.S::compute(x, y);
+      }
+    });
+  }
+
+  auto name() const -> std::string {
+    return dispatch([](const auto& s) -> std::string {
+      using S = std::decay_t<decltype(s)>;
+      if constexpr(std::is_same_v<S, std::monostate>){
+        return "none";
+      } else if constexpr(std::is_same_v<S, std::unique_ptr<IStrategy>>){
+        return s ? s->name() : "none";
+      } else {
+        return s.S::name();
+      }
+    });
+  }
+
+private:
+  // A switch on the index rather than std::visit, which libstdc++ implements with a table
+  // of function pointers: the optimizer sees every case and can inline the strategy.
+  template<typename F>
+  auto dispatch(F&& f) const -> decltype(f(std::monostate{})) {
+    switch(strategy.index()){
+    case 1:  return f(*std::get_if<1>(&strategy));
+    case 2:  return f(*std::get_if<2>(&strategy));
+    case 3:  return f(*std::get_if<3>(&strategy));
+    case 4:  return f(*std::get_if<4>(&strategy));
+    default: return f(std::monostate{});
+    }
+  }
+
+  Strategy strategy;
+};
+
+//Static Context: the strategy is fixed at compile time, no dispatch at all
+template<typename S>
+class StaticContext{
+public:
+  explicit StaticContext(S s): strategy(std::move(s)) { }
+
+  auto compute(double x, double y) const -> double {
+    return strategy.S::compute(x, y);
+  }
+private:
+  S strategy;
+};
+
+//------- Dispatch benchmark -------//
+// The same linear combination in a tight loop through the three dispatch forms, writing
+// independent results so that the loop measures the calls and not a dependency chain.
+// The virtual form hides the strategy behind an opaque pointer, as Context does.
+auto runDispatchBenchmark(int calls) -> void {
+  using Clock = std::chrono::steady_clock;
+  const LinearCombStrategy linear{5, 3, 4};
+  constexpr int block = 4096;
+  std::vector<double> xs(block), ys(block), out(block);
+  for(int i = 0; i < block; ++i){ xs[i] = 0.5 * i; ys[i] = 1.0 / (i + 1); }
+
+  const int rounds = std::max(1, calls / block);
+
+  auto measure = [&](auto&& compute){
+    double sum = 0;
+    const auto start = Clock::now();
+    for(int r = 0; r < rounds; ++r){
+      for(int i = 0; i < block; ++i){ out[i] = compute(xs[i], ys[i]); }
+      sum += out[r % block];
+    }
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return std::pair{elapsed.count() / (double(rounds) * block), sum};
+  };
+
+  std::unique_ptr<IStrategy> heap{linear.clone()};
+  const IStrategy* opaque = heap.get();
+  asm volatile("" : "+r"(opaque)); // the compiler cannot tell which strategy this is
+  const VariantContext variant{linear};
+  const StaticContext<LinearCombStrategy> fixed{linear};
+
+  const auto [virtualNs, virtualSum] = measure([&](double x, double y){ return opaque->compute(x, y); });
+  const auto [variantNs, variantSum] = measure([&](double x, double y){ return variant.compute(x, y); });
+  const auto [staticNs, staticSum]   = measure([&](double x, double y){ return fixed.compute(x, y); });
+
+  LOGI("==== Dispatch: ", rounds * block, " calls ====");
+  LOGI(std::fixed, std::setprecision(3), "  virtual = ", virtualNs, " ns/call ; variant = ", variantNs,
+       " ns/call ; static = ", staticNs, " ns/call",
+       (virtualSum == variantSum && variantSum == staticSum) ? "" : "  MISMATCH");
+}
+
+//Tuning Context:
+//Holds several interchangeable strategies and picks the fastest one per input size.
+//Sizes are grouped in power-of-two buckets; the first batched compute() in a bucket
+//times every candidate on that call's own data and caches the winner for the bucket.
+//Optionally the choice expires after a number of calls, and the choices can be saved to
+//a file and loaded at the next start to skip the measurements.
+//Time comes from an ITuningClock, so that tests can drive the selection with a fake one.
+struct ITuningClock{
+  virtual ~ITuningClock(){}
+  // Seconds since an arbitrary origin
+  virtual auto now() -> double = 0;
+};
+
+struct SteadyTuningClock: public ITuningClock{
+  auto now() -> double override{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+class TuningContext{
+public:
+  // Why a bucket uses the strategy it uses
+  struct Decision{
+    int                                      bucket;   // sizes in [2^bucket, 2^(bucket+1))
+    std::string                              winner;
+    std::string                              reason;   // "measured" or "loaded"
+    std::vector<std::pair<std::string, double>> seconds; // best time of each candidate
+  };
+
+  explicit TuningContext(ITuningClock& clock = defaultClock()): clock(clock) { }
+
+  auto addCandidate(const IStrategy& s) -> void {
+    candidates.emplace_back(s.clone());
+    choices.clear(); // the winners may change
+  }
+
+  // Measure again after `calls` computes in a bucket, 0 = never
+  auto setRetuneAfter(size_t calls) -> void { retuneAfter = calls; }
+  // Timed runs of each candidate, the best one counts
+  auto setRepetitions(int n) -> void { repetitions = std::max(1, n); }
+
+  auto compute(std::span<const double> xs, std::span<const double> ys, std::span<double> out) -> void {
+    if(candidates.empty()){
+        throw std::runtime_error("Error: no candidate strategy");
+    }
+    Choice& choice = choices[bucketOf(out.size())];
+    if(choice.strategy == nullptr || (retuneAfter != 0 && choice.calls >= retuneAfter)){
+      tune(bucketOf(out.size()), xs, ys, out);
+    }
+    ++choice.calls;
+    choice.strategy->compute(xs, ys, out);
+  }
+
+  // Strategy used for inputs of this size, nullptr before the first compute() in its bucket
+  auto chosen(size_t size) const -> const IStrategy* {
+    const auto it = choices.find(bucketOf(size));
+    return it == choices.end() ? nullptr : it->second.strategy;
+  }
+
+  auto decisions() const -> const std::vector<Decision>& { return log; }
+
+  // One "bucket name" line per tuned bucket
+  auto save(const std::filesystem::path& path) const -> bool {
+    std::ofstream file{path};
+    for(const auto& [bucket, choice]: choices){
+      if(choice.strategy != nullptr){ file << bucket << '\t' << choice.strategy->name() << '\n'; }
+    }
+    return bool(file);
+  }
+
+  // Returns the number of buckets restored; names matching no candidate are skipped
+  auto load(const std::filesystem::path& path) -> size_t {
+    std::ifstream file{path};
+    size_t restored = 0;
+    int bucket;
+    std::string name;
+    while(file >> bucket && file.get() == '\t' && std::getline(file, name)){
+      for(const auto& candidate: candidates){
+        if(candidate->name() != name){ continue; }
+        choices[bucket] = Choice{candidate.get(), 0};
+        log.push_back({bucket, name, "loaded", {}});
+        LOGI("[tuning] bucket 2^", bucket, ": ", name, " (loaded from ", path.string(), ")");
+        ++restored;
+        break;
+      }
+    }
+    return restored;
+  }
+
+private:
+  struct Choice{
+    const IStrategy* strategy = nullptr;
+    size_t           calls    = 0;
+  };
+
+  static auto defaultClock() -> ITuningClock& {
+    static SteadyTuningClock clock;
+    return clock;
+  }
+
+  static auto bucketOf(size_t size) -> int {
+    return size == 0 ? 0 : std::bit_width(size) - 1;
+  }
+
+  auto tune(int bucket, std::span<const double> xs, std::span<const double> ys, std::span<double> out) -> void {
+    Decision decision{bucket, "", "measured", {}};
+    const IStrategy* best = nullptr;
+    double bestSeconds = 0;
+    for(const auto& candidate: candidates){
+      double seconds = 0;
+      for(int r = 0; r < repetitions; ++r){
+        const double start = clock.now();
+        candidate->compute(xs, ys, out);
+        const double elapsed = clock.now() - start;
+        seconds = (r == 0) ? elapsed : std::min(seconds, elapsed);
+      }
+      decision.seconds.push_back({candidate->name(), seconds});
+      if(best == nullptr || seconds < bestSeconds){
+        best = candidate.get();
+        bestSeconds = seconds;
+      }
+    }
+    decision.winner = best->name();
+    choices[bucket] = Choice{best, 0};
+
+    LOGI("[tuning] bucket 2^", bucket, " (", out.size(), " elements): chose ", decision.winner);
+    for(const auto& [name, seconds]: decision.seconds){
+      LOGI("[tuning]   ", std::setw(36), name, std::fixed, std::setprecision(3),
+           std::setw(10), seconds * 1e9 / std::max<size_t>(1, out.size()), " ns/element");
+    }
+    log.push_back(std::move(decision));
+  }
+
+  ITuningClock&                           clock;
+  std::vector<std::unique_ptr<IStrategy>> candidates;
+  std::map<int, Choice>                   choices;
+  std::vector<Decision>                   log;
+  size_t                                  retuneAfter = 0;
+  int                                     repetitions = 3;
+};
+
+//------- Tuning checks -------//
+// Fake clock advanced by fake strategies by the time they pretend to take, which makes
+// the choices of TuningContext deterministic.
+struct FakeTuningClock: public ITuningClock{
+  double seconds = 0;
+  auto now() -> double override{ return seconds; }
+};
+
+struct FakeCostStrategy: public IStrategy{
+  std::string      label;
+  FakeTuningClock& clock;
+  double           fixed, perElement; // seconds
+  int*             runs;              // batched computes of this strategy and of its clones
+
+  FakeCostStrategy(std::string label, FakeTuningClock& clock, double fixed, double perElement, int* runs)
+    : label(std::move(label)), clock(clock), fixed(fixed), perElement(perElement), runs(runs) { }
+
+  auto name() const -> const std::string override{ return label; }
+  auto compute(double x, double y) const -> double override{ return x + y; }
+  auto compute(std::span<const double> xs, std::span<const double> ys,
+               std::span<double> out) const -> void override{
+    checkBatch(xs, ys, out);
+    clock.seconds += fixed + perElement * out.size();
+    ++*runs;
+    for(size_t i = 0; i < out.size(); ++i){ out[i] = xs[i] + ys[i]; }
+  }
+  auto clone() const -> IStrategy* { return new FakeCostStrategy(*this); }
+};
+
+// Returns false if any check fails
+auto runTuningChecks() -> bool {
+  bool ok = true;
+  auto check = [&ok](bool condition, const char* what){
+    LOGI("[check] ", condition ? "ok     " : "FAILED ", what);
+    ok = ok && condition;
+  };
+
+  FakeTuningClock clock;
+  int setupRuns = 0, streamRuns = 0;
+  // "setup" pays 1 ms once, then 1 ns per element; "stream" pays 10 ns per element:
+  // stream wins below ~111k elements, setup above
+  const FakeCostStrategy setup{"setup", clock, 1e-3, 1e-9, &setupRuns};
+  const FakeCostStrategy stream{"stream", clock, 0, 10e-9, &streamRuns};
+
+  TuningContext tuner{clock};
+  tuner.addCandidate(setup);
+  tuner.addCandidate(stream);
+  tuner.setRepetitions(2);
+
+  std::vector<double> xs(1 << 18, 1.0), ys(1 << 18, 2.0), out(1 << 18);
+  auto run = [&](size_t n){ tuner.compute({xs.data(), n}, {ys.data(), n}, {out.data(), n}); };
+
+  run(1000);
+  run(200000);
+  check(tuner.chosen(1000) && tuner.chosen(1000)->name() == "stream", "small inputs use the per-element strategy");
+  check(tuner.chosen(200000) && tuner.chosen(200000)->name() == "setup", "large inputs use the fixed-cost strategy");
+  check(tuner.chosen(5) == nullptr, "untouched buckets are not tuned");
+  check(out[0] == 3.0 && out[199999] == 3.0, "results come from the chosen strategy");
+
+  const int runsBefore = setupRuns + streamRuns;
+  run(1023); // same bucket as 1000
+  check(setupRuns + streamRuns == runsBefore + 1, "a tuned bucket runs only its winner");
+
+  tuner.setRetuneAfter(3);
+  run(1000);                                 // 3rd call in the bucket
+  check(setupRuns + streamRuns == runsBefore + 2, "no measurement before the schedule expires");
+  run(1000);                                 // 4 measured runs + 1 real run
+  check(setupRuns + streamRuns == runsBefore + 7, "the choice is measured again once expired");
+  check(tuner.decisions().size() == 3, "every measurement is recorded");
+
+  // One file per process, so that concurrent runs do not share it; removed on every way out
+  struct TempFile{
+    std::filesystem::path path;
+    ~TempFile(){ std::error_code ignored; std::filesystem::remove(path, ignored); }
+  };
+  const TempFile file{std::filesystem::temp_directory_path()
+                      / ("strategy_tuning." + std::to_string(::getpid()) + ".txt")};
+  const auto& path = file.path;
+  check(tuner.save(path), "choices saved");
+  TuningContext restarted{clock};
+  restarted.addCandidate(setup);
+  restarted.addCandidate(stream);
+  check(restarted.load(path) == 2, "choices loaded");
+  const int runsBeforeRestart = setupRuns + streamRuns;
+  restarted.compute({xs.data(), 200000}, {ys.data(), 200000}, {out.data(), 200000});
+  check(setupRuns + streamRuns == runsBeforeRestart + 1 && restarted.chosen(200000)->name() == "setup",
+        "loaded choices skip the measurement");
+  return ok;
+}
+
+//Concurrent Context:
+//compute() may run on many threads while another one calls setStrategy(): the strategy is
+//published with an atomic exchange and the previous one is reclaimed through epoch::Domain
+//(EpochReclaim.hpp), never while a compute() may still be using it. compute() is wait-free.
+//A compute() may call another ConcurrentContext: critical sections nest.
+//The context itself must not be destroyed while compute() runs.
+class ConcurrentContext{
+public:
+  explicit ConcurrentContext(const IStrategy& s): strategy{s.clone()} { }
+  ~ConcurrentContext(){ delete strategy.load(std::memory_order_acquire); }
+  ConcurrentContext(const ConcurrentContext&) = delete;
+  ConcurrentContext& operator=(const ConcurrentContext&) = delete;
+
+  auto setStrategy(const IStrategy& s) -> void { publish(s.clone()); }
+  auto setStrategy(std::unique_ptr<IStrategy> s) -> void { publish(s.release()); }
+
+  auto compute(double x, double y) const -> double {
+    epoch::Guard guard;
+    return strategy.load(std::memory_order_seq_cst)->compute(x, y);
+  }
+
+  auto compute(std::span<const double> xs, std::span<const double> ys, std::span<double> out) const -> void {
+    epoch::Guard guard;
+    strategy.load(std::memory_order_seq_cst)->compute(xs, ys, out);
+  }
+
+private:
+  auto publish(const IStrategy* s) -> void {
+    if(nullptr == s){
+        throw std::runtime_error("Error: strategy not set");
+    }
+    epoch::retire(strategy.exchange(s, std::memory_order_seq_cst));
+  }
+
+  std::atomic<const IStrategy*> strategy;
+};
+
+//Locked Context: the straightforward thread-safe alternative, for comparison
+class LockedContext{
+public:
+  explicit LockedContext(const IStrategy& s): strategy{s.clone()} { }
+
+  auto setStrategy(const IStrategy& s) -> void {
+    std::unique_ptr<IStrategy> next{s.clone()};
+    std::lock_guard<std::mutex> lock{mutex};
+    strategy.swap(next);
+  }
+
+  auto compute(double x, double y) const -> double {
+    std::lock_guard<std::mutex> lock{mutex};
+    return strategy->compute(x, y);
+  }
+private:
+  mutable std::mutex         mutex;
+  std::unique_ptr<IStrategy> strategy;
+};
+
+// Thread counts a scaling benchmark measures: the powers of two below the number of
+// cores, then every core (1 2 4 6 for 6 cores)
+auto threadCounts() -> std::vector<unsigned> {
+  const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned> counts;
+  for(unsigned n = 1; n < cores; n *= 2){ counts.push_back(n); }
+  counts.push_back(cores);
+  return counts;
+}
+
+//------- Hot-swap stress test and benchmark -------//
+// Strategy checking it is still alive whenever it is used. With -fsanitize=thread (or
+// address), a use after free of a swapped-out strategy is reported as well.
+struct CanaryStrategy: public IStrategy{
+  static constexpr std::uint64_t Alive = 0xA11CEA11CEull, Dead = 0xDEADDEADull;
+  static inline std::atomic<long> instances{0};
+  double offset;
+  std::atomic<std::uint64_t> canary{Alive};
+
+  explicit CanaryStrategy(double offset): offset(offset) { ++instances; }
+  CanaryStrategy(const CanaryStrategy& other): IStrategy(other), offset(other.offset) { ++instances; }
+  ~CanaryStrategy(){ canary.store(Dead); --instances; }
+
+  auto name() const -> const std::string override{ return "canary"; }
+  auto compute(double x, double y) const -> double override{
+    if(canary.load(std::memory_order_relaxed) != Alive){ return -1; }
+    return x + y + offset;
+  }
+  auto clone() const -> IStrategy* { return new CanaryStrategy(*this); }
+};
+
+// Readers compute continuously while a writer swaps the strategy; every result must come
+// from a live strategy, and every swapped-out strategy must eventually be deleted.
+// Run alone under ThreadSanitizer:
+//   g++ -std=c++20 -O1 -g -fsanitize=thread -pthread Stratergy.cpp && ./a.out --stress
+auto runHotSwapStressTest(int readers, int swaps) -> bool {
+  std::atomic<bool> stop{false};
+  std::atomic<long> bad{0}, computes{0};
+  alog::setMuted(true); // the strategies trace every clone and destruction
+  {
+    ConcurrentContext ctx{CanaryStrategy{0}};
+    std::vector<std::thread> threads;
+    for(int t = 0; t < readers; ++t){
+      threads.emplace_back([&]{
+        long n = 0;
+        while(!stop.load(std::memory_order_relaxed)){
+          const double r = ctx.compute(1.0, 2.0);   // 3 + offset, offset in [0, 8)
+          if(r < 3.0 || r >= 11.0){ bad.fetch_add(1); }
+          ++n;
+        }
+        computes.fetch_add(n);
+      });
+    }
+    for(int i = 0; i < swaps; ++i){
+      ctx.setStrategy(CanaryStrategy(i % 8));
+      if(i % 64 == 0){ std::this_thread::yield(); }
+    }
+    stop = true;
+    for(auto& t: threads){ t.join(); }
+  }
+  // Every reader is gone: whatever is still retired can be deleted now
+  epoch::synchronize();
+  alog::setMuted(false);
+  const long leaked = CanaryStrategy::instances.load();
+  LOGI("  stress: ", readers, " readers, ", swaps, " swaps, ", computes.load(), " computes, ",
+       bad.load(), " bad results, ", leaked, " strategies leaked");
+  return bad.load() == 0 && leaked == 0;
+}
+
+// Compute throughput of all the reader threads while the strategy is swapped every 100 us
+auto runHotSwapBenchmark() -> void {
+  using namespace std::chrono_literals;
+  const LinearCombStrategy a{5, 3, 4}, b{6, 5, 10};
+  LOGI("  ", std::setw(8), "threads", std::setw(20), "epoch [M/s]", std::setw(20), "mutex [M/s]", std::setw(10), "swaps");
+
+  auto measure = [&](auto& ctx, unsigned threadCount, long& swaps){
+    std::atomic<bool> stop{false};
+    std::atomic<long> computes{0};
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < threadCount; ++t){
+      threads.emplace_back([&, t]{
+        long n = 0;
+        double sum = 0;
+        while(!stop.load(std::memory_order_relaxed)){
+          for(int i = 0; i < 256; ++i){ sum += ctx.compute(i, t); }
+          n += 256;
+        }
+        computes.fetch_add(n + (sum == -1 ? 1 : 0));
+      });
+    }
+    const auto start = std::chrono::steady_clock::now();
+    swaps = 0;
+    while(std::chrono::steady_clock::now() - start < 300ms){
+      ctx.setStrategy(swaps % 2 ? a : b);
+      ++swaps;
+      std::this_thread::sleep_for(100us);
+    }
+    stop = true;
+    for(auto& t: threads){ t.join(); }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return computes.load() / elapsed.count() / 1e6;
+  };
+
+  for(const unsigned n: threadCounts()){
+    ConcurrentContext epoch{a};
+    LockedContext     locked{a};
+    long epochSwaps = 0, lockedSwaps = 0;
+    alog::setMuted(true); // every swap traces a clone and a destruction
+    const double epochRate  = measure(epoch, n, epochSwaps);
+    const double lockedRate = measure(locked, n, lockedSwaps);
+    alog::setMuted(false);
+    LOGI("  ", std::setw(8), n, std::fixed, std::setprecision(1), std::setw(20), epochRate,
+         std::setw(20), lockedRate, std::setw(10), epochSwaps);
+  }
+}
+
+//------- Strategy switch benchmark -------//
+// Cost of one setStrategy() call: clone() of a const& (heap) against moving a temporary
+// into the context (inline when it fits), logging muted.
+auto runSwitchBenchmark(long switches) -> void {
+  using Clock = std::chrono::steady_clock;
+  const LinearCombStrategy a{5, 3, 4}, b{6, 5, 10};
+  Context ctx{a};
+  double x = 0, y = 1, result = 0, sum = 0;
+
+  // Returns the allocations per switch
+  auto measure = [&](const char* label, auto&& setNext) -> double {
+    const size_t allocationsBefore = alloc::count();
+    const size_t heapBefore = StrategyHolderStats::heapAllocations.load();
+    alog::setMuted(true); // constructors and destructors trace
+    const auto start = Clock::now();
+    for(long i = 0; i < switches; ++i){
+      setNext(i);
+      x = double(i);
+      ctx.compute({&x, 1}, {&y, 1}, {&result, 1});
+      sum += result;
+    }
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    alog::setMuted(false);
+    LOGI("  ", std::left, std::setw(30), label, std::right, std::fixed, std::setprecision(1),
+         std::setw(10), elapsed.count() / switches, " ns", std::setw(10), std::setprecision(2),
+         double(alloc::count() - allocationsBefore) / switches, std::setw(12),
+         double(StrategyHolderStats::heapAllocations.load() - heapBefore) / switches,
+         std::setw(8), ctx.isInline() ? "yes" : "no");
+    return double(alloc::count() - allocationsBefore) / switches;
+  };
+
+  LOGI("==== Strategy switch cost, ", switches, " switches ====");
+  LOGI("  ", std::left, std::setw(30), "path", std::right, std::setw(13), "time/switch",
+       std::setw(10), "allocs", std::setw(12), "holder heap", std::setw(8), "inline");
+  measure("setStrategy(const&) clone", [&](long i){ ctx.setStrategy(i % 2 ? a : b); });
+  measure("setStrategy(new ...)", [&](long i){ ctx.setStrategy(new LinearCombStrategy{6, 5, double(i)}); });
+  const double moveAllocations =
+    measure("setStrategy(&&) move", [&](long i){ ctx.setStrategy(LinearCombStrategy{6, 5, double(i)}); });
+  assert(moveAllocations == 0 && "moving a small strategy in must stay inline");
+  static_cast<void>(moveAllocations);
+  // Too large for the inline buffer: one holder allocation, the rest is parsing the formula
+  measure("parse + setStrategy(&&) large", [&](long i){
+    ExpressionStrategy expression{i % 2 ? "5 * x + 3 * y + 4" : "6 * x + 5 * y + 10"};
+    ctx.setStrategy(std::move(expression));
+  });
+  {
+    // The formula, code and constants change hands: the holder is the only allocation
+    ExpressionStrategy expression{"5 * x + 3 * y + 4"};
+    alog::setMuted(true);
+    const size_t allocationsBefore = alloc::count();
+    ctx.setStrategy(std::move(expression));
+    const size_t moveAllocations = alloc::count() - allocationsBefore;
+    alog::setMuted(false);
+    LOGI("  moving an ExpressionStrategy in: ", moveAllocations, " allocation(s)");
+    assert(moveAllocations == 1 && "moving a large strategy in must not copy it");
+  }
+  LOGI("  sizeof(LinearCombStrategy) = ", sizeof(LinearCombStrategy), " ; sizeof(ExpressionStrategy) = ",
+       sizeof(ExpressionStrategy), " ; inline capacity = 64 (checksum ", sum, ")");
+}
+
+//------- Expression benchmark -------//
+// The compiled formula against the hand-written LinearCombStrategy, per call and batched.
+// That formula takes the affine fast path; a second one shows the bytecode interpreter.
+auto runExpressionBenchmark(size_t size) -> void {
+  using Clock = std::chrono::steady_clock;
+  const LinearCombStrategy handWritten{5, 3, 4};
+  const ExpressionStrategy expression{"5 * x + 3 * y + 4"};
+  const ExpressionStrategy bytecode{"max(x, y) * 5 + y"};
+  std::vector<double> xs(size), ys(size), expected(size), out(size);
+  for(size_t i = 0; i < size; ++i){ xs[i] = 0.5 * i; ys[i] = 1.0 / (i + 1); }
+  constexpr int rounds = 20;
+
+  auto throughput = [&](auto&& run){
+    const auto start = Clock::now();
+    for(int r = 0; r < rounds; ++r){ run(); }
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    return rounds * size / elapsed.count() / 1e6;
+  };
+  auto perCall = [&](const IStrategy& s, std::vector<double>& results){
+    return throughput([&]{ for(size_t i = 0; i < size; ++i){ results[i] = s.compute(xs[i], ys[i]); } });
+  };
+  auto batched = [&](const IStrategy& s, std::vector<double>& results){
+    return throughput([&]{ s.compute(xs, ys, results); });
+  };
+
+  const double handCall = perCall(handWritten, expected);
+  const double exprCall = perCall(expression, out);
+  bool same = expected == out;
+  const double handBatch = batched(handWritten, expected);
+  const double exprBatch = batched(expression, out);
+  same = same && expected == out;
+  const double bytecodeBatch = batched(bytecode, out);
+
+  LOGI("==== Expression \"", expression.name(), "\" vs LinearCombStrategy, M elements/s ====");
+  LOGI(std::fixed, std::setprecision(1), "  per call: hand-written = ", handCall, " ; expression = ", exprCall,
+       " (", handCall / exprCall, "x slower)");
+  LOGI("  batched:  hand-written = ", handBatch, " ; expression = ", exprBatch,
+       " (", handBatch / exprBatch, "x slower)", same ? "" : "  MISMATCH");
+  LOGI("  batched:  bytecode \"", bytecode.name(), "\" = ", bytecodeBatch);
+}
+
+//------- Logging benchmark -------//
+// Stream discarding what it is given, so that only the cost of the callers is measured
+class NullBuffer: public std::streambuf {
+protected:
+  auto overflow(int c) -> int override { return c; }
+  auto xsputn(const char*, std::streamsize n) -> std::streamsize override { return n; }
+};
+
+// Hot-path log calls: the former synchronous helper formatting on the caller thread
+// against the deferred path. Per call latency includes two steady_clock reads.
+// The deferred calls still get formatted, by the background thread: with fewer cores than
+// busy threads that work shares the caller's core, and throughput falls below the
+// synchronous one. The deferred path wins on caller latency, not on total work.
+auto runLogBenchmark(int calls) -> void {
+  using Clock = std::chrono::steady_clock;
+  NullBuffer nullBuffer;
+  std::ostream nullStream{&nullBuffer};
+  const std::string name = "Linear combination a * x + b * y + c";
+
+  auto measure = [&](const char* label, auto&& logCall){
+    std::vector<double> latencies(calls);
+    const auto start = Clock::now();
+    for(int i = 0; i < calls; ++i){
+      const auto before = Clock::now();
+      logCall(i);
+      latencies[i] = std::chrono::duration<double, std::nano>(Clock::now() - before).count();
+    }
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::sort(latencies.begin(), latencies.end());
+    return [=]{
+      LOGI(" ", std::setw(12), label, std::fixed, std::setprecision(2),
+           std::setw(10), calls / elapsed.count() / 1e6, " M calls/s",
+           " ; p50 = ", std::setw(7), latencies[calls / 2], " ns",
+           " ; p99 = ", std::setw(8), latencies[calls * 99 / 100], " ns");
+    };
+  };
+
+  auto sync = measure("synchronous", [&](int i){
+    nullStream << "[INFO]" << "strategy = " << name << " ( x = " << i << " ; y = " << 0.5 * i << " )" << '\n';
+  });
+
+  alog::Logger::instance().redirect(nullStream);
+  const size_t stallsBefore = alog::Logger::instance().stalls();
+  auto deferred = measure("deferred", [&](int i){
+    LOGI("strategy = ", name, " ( x = ", i, " ; y = ", 0.5 * i, " )");
+  });
+  const size_t stalls = alog::Logger::instance().stalls() - stallsBefore;
+  alog::Logger::instance().redirect(std::cout);
+
+  LOGI("==== Logging: ", calls, " hot-path calls, ", std::thread::hardware_concurrency(), " core(s) ====");
+  sync();
+  deferred();
+  LOGI("  callers found their ring full ", stalls, " times");
+}
+
+//------- Batched compute benchmark -------//
+// Elements per second of the default batched compute (one virtual scalar call per element)
+// against each strategy's vectorized kernel. The arrays start one element past the
+// allocation, so they are not 32-byte aligned, and the sizes leave odd tails.
+auto runBatchBenchmark() -> void {
+  using Clock = std::chrono::steady_clock;
+  constexpr size_t elementsPerSize = 40000000;
+  const AddStrategy add;
+  const MulStrategy mul;
+  const LinearCombStrategy linear{5, 3, 4};
+
+  LOGI("==== Batched compute, M elements/s ====");
+  LOGI(std::setw(28), "strategy", std::setw(10), "size", std::setw(12), "scalar",
+       std::setw(12), "batched", std::setw(10), "speedup");
+  for(const IStrategy* strategy: {static_cast<const IStrategy*>(&add), static_cast<const IStrategy*>(&mul),
+                                  static_cast<const IStrategy*>(&linear)}){
+    for(size_t size: {1021, 65537, 4000003}){
+      std::vector<double> xs(size + 1), ys(size + 1), scalarOut(size + 1), batchedOut(size + 1);
+      for(size_t i = 0; i <= size; ++i){ xs[i] = 0.5 * i; ys[i] = 1.0 / (i + 1); }
+      const std::span<const double> x{xs.data() + 1, size}, y{ys.data() + 1, size};
+      const size_t rounds = std::max<size_t>(1, elementsPerSize / size);
+
+      auto throughput = [&](auto&& run){
+        const auto start = Clock::now();
+        for(size_t r = 0; r < rounds; ++r){ run(); }
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        return rounds * size / elapsed.count() / 1e6;
+      };
+      const double scalar  = throughput([&]{ strategy->IStrategy::compute(x, y, {scalarOut.data() + 1, size}); });
+      const double batched = throughput([&]{ strategy->compute(x, y, {batchedOut.data() + 1, size}); });
+      const bool same = std::memcmp(scalarOut.data(), batchedOut.data(), sizeof(double) * (size + 1)) == 0;
+
+      LOGI(std::setw(28), strategy->name().substr(0, 26), std::setw(10), size, std::fixed, std::setprecision(1),
+           std::setw(12), scalar, std::setw(12), batched, std::setw(9), batched / scalar, "x",
+           same ? "" : "  MISMATCH with the scalar results");
+    }
+  }
+}
+
+//------- Parallel benchmark -------//
+// LinearCombStrategy over columns of `size` elements: serial batched compute against the
+// pool from 1 thread to every core, then the effect of the chunk size on every core.
+// Each parallel output is compared bit for bit with the serial one.
+auto runParallelBenchmark(size_t size) -> void {
+  using Clock = std::chrono::steady_clock;
+  const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  Context ctx{LinearCombStrategy{5, 3, 4}};
+  constexpr int rounds = 5;
+
+  WorkStealingPool filler{cores};
+  auto xs = allocateColumn(filler, size), ys = allocateColumn(filler, size), serial = allocateColumn(filler, size);
+  filler.parallelFor(size, WorkStealingPool::DefaultChunk, [&](size_t begin, size_t end){
+    for(size_t i = begin; i < end; ++i){ xs[i] = 0.5 * i; ys[i] = 1.0 / (i + 1); }
+  });
+  const std::span<const double> x{xs.get(), size}, y{ys.get(), size};
+
+  auto throughput = [&](auto&& run){
+    run(); // warm up
+    const auto start = Clock::now();
+    for(int r = 0; r < rounds; ++r){ run(); }
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    return rounds * size / elapsed.count() / 1e6;
+  };
+  const double serialRate = throughput([&]{ ctx.compute(x, y, {serial.get(), size}); });
+
+  LOGI("==== Parallel compute, ", size, " elements, M elements/s ====");
+  LOGI("  serial: ", std::fixed, std::setprecision(1), serialRate);
+  LOGI("  ", std::setw(8), "threads", std::setw(12), "chunk", std::setw(12), "parallel",
+       std::setw(10), "speedup", std::setw(10), "steals");
+  auto report = [&](unsigned threads, size_t chunk){
+    WorkStealingPool pool{threads};
+    auto out = allocateColumn(pool, size, chunk);
+    const double rate = throughput([&]{ ctx.compute(pool, x, y, {out.get(), size}, chunk); });
+    const bool same = std::memcmp(out.get(), serial.get(), sizeof(double) * size) == 0;
+    LOGI("  ", std::setw(8), threads, std::setw(12), chunk, std::fixed, std::setprecision(1),
+         std::setw(12), rate, std::setw(9), rate / serialRate, "x", std::setw(10), pool.steals(),
+         same ? "" : "  MISMATCH with the serial results");
+  };
+  for(const unsigned n: threadCounts()){ report(n, WorkStealingPool::DefaultChunk); }
+  // Small chunks pay the deque locking per chunk, huge ones leave little to steal
+  for(size_t chunk: {size_t(256), size_t(1) << 12, size_t(1) << 20, size}){
+    report(cores, chunk);
+  }
+}
+
+//------- Trace overhead -------//
+// Nanoseconds added by one TRACE_SCOPE around an empty body, tracing disabled at run time
+// and enabled (the recorded spans are then cleared). Build with -DTRACE_ENABLED=0 to
+// compile the spans out: both columns should then read about 0.
+auto runTraceOverheadBenchmark(int spans) -> void {
+  using Clock = std::chrono::steady_clock;
+  const bool wasEnabled = trace::Tracer::enabled();
+  std::atomic<int> sink{0};
+
+  auto perIteration = [&](auto&& body){
+    const auto start = Clock::now();
+    for(int i = 0; i < spans; ++i){ body(i); }
+    const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / spans;
+  };
+  const double baseline = perIteration([&](int i){ sink.store(i, std::memory_order_relaxed); });
+  trace::setEnabled(false);
+  const double disabled = perIteration([&](int i){
+    TRACE_SCOPE("overhead");
+    sink.store(i, std::memory_order_relaxed);
+  });
+  trace::setEnabled(true);
+  const double enabled = perIteration([&](int i){
+    TRACE_SCOPE("overhead");
+    sink.store(i, std::memory_order_relaxed);
+  });
+  trace::setEnabled(wasEnabled);
+  trace::Tracer::instance().clear();
+
+  LOGI("==== Trace overhead, ", spans, " spans ====");
+  LOGI(std::fixed, std::setprecision(1), "  per span: disabled = ", std::max(0.0, disabled - baseline),
+       " ns ; enabled = ", std::max(0.0, enabled - baseline), " ns ; compiled in = ", TRACE_ENABLED ? "yes" : "no");
+}
+
+int main(int argc, char** argv){
+    if(argc > 1 && std::string(argv[1]) == "--stress"){
+      const bool passed = runHotSwapStressTest(4, 20000);
+      LOGI("hot-swap stress test ", passed ? "passed" : "FAILED");
+      return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // --trace=FILE records the demo below and a parallel compute, not the benchmarks
+    const auto traceFile = trace::fileFromArgs(argc, argv);
+    trace::setEnabled(traceFile.has_value());
 
     Context ctx;
     LOGI("==== Strategy = add ====");
@@ -198,10 +1854,66 @@ int main(){
     ctx.compute(5.0, 3.0);  
 
     LOGI("==== Strategy = Linear combination [2] ====");  
-    // Copy stack-allocated temporary object comb1 using the virtual constructor
-    // clone
+    // Move the temporary object into the context: stored inline, no clone
     ctx.setStrategy(LinearCombStrategy{6.0, 5.0, 10.0});
     ctx.compute(2.0, 6.0);
 
-    return EXIT_SUCCESS;
+    LOGI("==== Variant context ====");
+    // Built-in strategies live inside the context, no clone and no heap allocation
+    VariantContext vctx{LinearCombStrategy{5, 3, 4}};
+    LOGI("strategy = ", vctx.name(), " Result = ", vctx.compute(3.0, 4.0));
+    vctx.setStrategy(MulStrategy{});
+    LOGI("strategy = ", vctx.name(), " Result = ", vctx.compute(3.0, 4.0));
+    vctx.setStrategy(std::unique_ptr<IStrategy>(new AddStrategy));
+    LOGI("strategy = ", vctx.name(), " Result = ", vctx.compute(3.0, 4.0));
+
+    LOGI("==== Strategy = expression ====");
+    ctx.setStrategy(new ExpressionStrategy("5 * x + 3 * y + 4"));
+    ctx.compute(3.0, 4.0);
+    // The constant part is folded: sqrt(16) / 2^2 + 3 => 4, the program has 4 instructions
+    const ExpressionStrategy folded{"max(x, y) * (sqrt(16) / 2^2 + 3) - -y"};
+    LOGI("strategy = ", folded.name(), " ; instructions = ", folded.program.size(),
+         " ; Result = ", folded.compute(3.0, 4.0));
+    try {
+      ExpressionStrategy broken{"5 * x + * y"};
+    } catch(const std::invalid_argument& e){
+      LOGI(e.what());
+    }
+
+    if(traceFile){
+      WorkStealingPool pool;
+      std::vector<double> xs(1 << 20, 1.5), ys(1 << 20, 2.5), out(1 << 20);
+      ctx.compute(pool, xs, ys, out);
+    }
+    trace::setEnabled(false);
+    if(traceFile){
+      const bool saved = trace::save(*traceFile);
+      LOGI(saved ? "trace written to " : "cannot write the trace to ", *traceFile);
+    }
+
+    runLogBenchmark(200000);
+    runBatchBenchmark();
+    runDispatchBenchmark(50000000);
+    runExpressionBenchmark(1000003);
+    runSwitchBenchmark(2000000);
+    runParallelBenchmark(size_t(1) << 24);
+    runTraceOverheadBenchmark(1000000);
+
+    LOGI("==== Tuning context ====");
+    const bool checksPassed = runTuningChecks();
+    // Real candidates timed on this machine
+    TuningContext tuner;
+    tuner.addCandidate(LinearCombStrategy{5, 3, 4});
+    tuner.addCandidate(ExpressionStrategy{"5 * x + 3 * y + 4"});
+    std::vector<double> xs(1 << 20, 1.5), ys(1 << 20, 2.5), out(1 << 20);
+    for(size_t n: {100, 1 << 20}){
+      tuner.compute({xs.data(), n}, {ys.data(), n}, {out.data(), n});
+    }
+
+
+    LOGI("==== Concurrent context ====");
+    const bool stressPassed = runHotSwapStressTest(4, 20000);
+    runHotSwapBenchmark();
+
+    return (checksPassed && stressPassed) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
\ No newline at end of file
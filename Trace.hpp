@@ -0,0 +1,354 @@
+// Scoped tracing with Chrome trace-event export
+/*
+    Shared by the demos to see where the time goes in the pattern hot paths (compute, draw,
+    notify) without printing from them: printing a trace line costs far more than the call
+    it describes.
+
+        TRACE_SCOPE("Group::draw");   // span from here to the end of the enclosing scope
+
+    Two switches:
+      - compile time: with -DTRACE_ENABLED=0, TRACE_SCOPE() expands to nothing.
+      - run time: spans are recorded only while setEnabled(true); otherwise a span costs a
+        relaxed load and a branch. Tracing starts disabled.
+
+    Each thread records its spans in its own buffer, a list of fixed-size blocks that
+    only that thread writes. A block publishes its event count with a release store, so
+    save() can read every completed span while other threads are still recording; no lock
+    and no allocation except one block every BlockEvents spans. Past MaxEvents spans a
+    thread drops its new spans and counts them.
+
+    Spans are stamped with the cheapest clock available: the time-stamp counter on x86-64
+    (rdtsc, a few ns, constant rate on current CPUs), the steady clock elsewhere. Ticks are
+    converted to nanoseconds on the steady clock only at export, with a rate measured
+    between the creation of the tracer and the export.
+
+    Span names must outlive the tracer: string literals.
+    save() writes the Chrome trace-event JSON format, which chrome://tracing and
+    https://ui.perfetto.dev open: one complete ("X") event per span, one track per thread.
+*/
+#pragma once
+
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+namespace trace {
+
+/** Nanoseconds on the steady clock */
+inline auto now() -> std::int64_t
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** Timestamp of a span: TSC ticks on x86-64, steady clock nanoseconds elsewhere */
+inline auto ticks() -> std::int64_t
+{
+#if defined(__x86_64__)
+    return static_cast<std::int64_t>(__rdtsc());
+#else
+    return now();
+#endif
+}
+
+namespace detail {
+
+struct Event
+{
+    const char*  name;
+    std::int64_t start;    // ticks
+    std::int64_t duration; // ticks
+};
+
+// Pair of readings of both clocks, to convert ticks to steady clock nanoseconds
+struct ClockPoint
+{
+    std::int64_t ticks;
+    std::int64_t ns;
+
+    static auto sample() -> ClockPoint
+    {
+        const std::int64_t before = trace::ticks();
+        const std::int64_t ns = now();
+        const std::int64_t after = trace::ticks();
+        return {before + (after - before) / 2, ns};
+    }
+};
+
+// Single writer: the owning thread. Readers only see the events published by count.
+class ThreadBuffer
+{
+public:
+    static constexpr size_t BlockEvents = 4096;
+    static constexpr size_t MaxEvents   = size_t(1) << 22;
+
+    explicit ThreadBuffer(std::uint32_t tid): m_tid(tid) { }
+
+    ~ThreadBuffer()
+    {
+        Block* block = m_head.next.load(std::memory_order_relaxed);
+        while(block){
+            Block* next = block->next.load(std::memory_order_relaxed);
+            delete block;
+            block = next;
+        }
+    }
+
+    ThreadBuffer(const ThreadBuffer&) = delete;
+    ThreadBuffer& operator=(const ThreadBuffer&) = delete;
+
+    auto record(const char* name, std::int64_t start, std::int64_t duration) -> void
+    {
+        if(m_tailCount == BlockEvents){
+            if(m_blocks * BlockEvents >= MaxEvents){
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            Block* block = new Block;
+            m_tail->next.store(block, std::memory_order_release);
+            m_tail = block;
+            m_tailCount = 0;
+            ++m_blocks;
+        }
+        m_tail->events[m_tailCount] = Event{name, start, duration};
+        m_tail->count.store(++m_tailCount, std::memory_order_release);
+    }
+
+    /** Reader side: calls f(event) for every published event, oldest first */
+    template<typename F>
+    auto forEach(F&& f) const -> void
+    {
+        for(const Block* block = &m_head; block; block = block->next.load(std::memory_order_acquire)){
+            const size_t count = block->count.load(std::memory_order_acquire);
+            for(size_t i = 0; i < count; ++i){ f(block->events[i]); }
+        }
+    }
+
+    auto tid() const -> std::uint32_t { return m_tid; }
+    auto dropped() const -> size_t { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Block
+    {
+        Event               events[BlockEvents];
+        std::atomic<size_t> count{0};
+        std::atomic<Block*> next{nullptr};
+    };
+
+    Block               m_head;
+    Block*              m_tail{&m_head};
+    size_t              m_tailCount{0}; // m_tail->count, as seen by the writer
+    size_t              m_blocks{1};
+    std::atomic<size_t> m_dropped{0};
+    const std::uint32_t m_tid;
+};
+
+inline auto writeJsonString(std::ostream& out, std::string_view text) -> void
+{
+    out << '"';
+    for(const char c: text){
+        if(c == '"' || c == '\\'){
+            out << '\\' << c;
+        } else if(static_cast<unsigned char>(c) < 0x20){
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace detail
+
+class Tracer
+{
+public:
+    static auto instance() -> Tracer&
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    static auto enabled() -> bool { return s_enabled.load(std::memory_order_relaxed); }
+    static auto setEnabled(bool enabled) -> void { s_enabled.store(enabled, std::memory_order_relaxed); }
+
+    /** Buffer of the calling thread, created on its first span */
+    auto buffer() -> detail::ThreadBuffer&
+    {
+        thread_local constinit detail::ThreadBuffer* cached = nullptr; // no TLS init guard on the hot path
+        if(cached == nullptr){
+            thread_local std::shared_ptr<detail::ThreadBuffer> owner{attach()};
+            cached = owner.get();
+        }
+        return *cached;
+    }
+
+    /** Leave the spans recorded so far out of later exports */
+    auto clear() -> void { m_clearedAt.store(ticks(), std::memory_order_relaxed); }
+
+    /** Spans an export would write */
+    auto eventCount() -> size_t
+    {
+        size_t count = 0;
+        forEachEvent([&](const detail::ThreadBuffer&, const detail::Event&){ ++count; });
+        return count;
+    }
+
+    /** Spans lost because a thread reached MaxEvents */
+    auto dropped() -> size_t
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        size_t total = 0;
+        for(const auto& b: m_buffers){ total += b->dropped(); }
+        return total;
+    }
+
+    /** Chrome trace-event JSON, timestamps in microseconds on the steady clock */
+    auto writeChromeJson(std::ostream& out) -> void
+    {
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+        out.setf(std::ios::fixed, std::ios::floatfield);
+        out.precision(3);
+        // ns = origin.ns + (ticks - origin.ticks) * nsPerTick
+        const detail::ClockPoint origin = m_origin;
+        detail::ClockPoint last = detail::ClockPoint::sample();
+        while(last.ns - origin.ns < CalibrationNs){
+            std::this_thread::sleep_for(std::chrono::nanoseconds(CalibrationNs - (last.ns - origin.ns)));
+            last = detail::ClockPoint::sample();
+        }
+        const double nsPerTick = last.ticks != origin.ticks
+                               ? double(last.ns - origin.ns) / double(last.ticks - origin.ticks) : 1.0;
+        auto toNs = [&](std::int64_t t){ return origin.ns + double(t - origin.ticks) * nsPerTick; };
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        auto separator = [&]{ out << (first ? "\n" : ",\n"); first = false; };
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            for(const auto& b: m_buffers){
+                separator();
+                out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid()
+                    << ",\"args\":{\"name\":\"thread " << b->tid() << "\"}}";
+            }
+        }
+        forEachEvent([&](const detail::ThreadBuffer& b, const detail::Event& e){
+            separator();
+            out << "{\"name\":";
+            detail::writeJsonString(out, e.name);
+            out << ",\"cat\":\"span\",\"ph\":\"X\",\"ts\":" << toNs(e.start) / 1000.0
+                << ",\"dur\":" << e.duration * nsPerTick / 1000.0 << ",\"pid\":1,\"tid\":" << b.tid() << '}';
+        });
+        out << "\n]}\n";
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    /** Write the trace to a file; returns false if it cannot be written */
+    auto save(const std::string& path) -> bool
+    {
+        std::ofstream file{path};
+        if(!file){ return false; }
+        writeChromeJson(file);
+        return static_cast<bool>(file);
+    }
+
+private:
+    // Shortest interval the tick rate is measured over, for a rate within about 1e-4
+    static constexpr std::int64_t CalibrationNs = 10'000'000;
+
+    Tracer(): m_origin(detail::ClockPoint::sample()) { }
+
+    auto attach() -> std::shared_ptr<detail::ThreadBuffer>
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_buffers.push_back(std::make_shared<detail::ThreadBuffer>(static_cast<std::uint32_t>(m_buffers.size() + 1)));
+        return m_buffers.back();
+    }
+
+    template<typename F>
+    auto forEachEvent(F&& f) -> void
+    {
+        const std::int64_t clearedAt = m_clearedAt.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for(const auto& b: m_buffers){
+            b->forEach([&](const detail::Event& e){ if(e.start >= clearedAt){ f(*b, e); } });
+        }
+    }
+
+    static inline std::atomic<bool>                   s_enabled{false};
+    const detail::ClockPoint                           m_origin;
+    std::atomic<std::int64_t>                          m_clearedAt{0};
+    std::mutex                                         m_mutex;
+    std::vector<std::shared_ptr<detail::ThreadBuffer>> m_buffers; // kept after their thread exits
+};
+
+/** Records one span from its construction to its destruction, if tracing was enabled */
+class Span
+{
+public:
+    explicit Span(const char* name)
+        : m_name(Tracer::enabled() ? name : nullptr), m_start(m_name ? ticks() : 0) { }
+
+    ~Span()
+    {
+        if(m_name){
+            const std::int64_t end = ticks();
+            Tracer::instance().buffer().record(m_name, m_start, end - m_start);
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+private:
+    const char*  m_name;
+    std::int64_t m_start;
+};
+
+inline auto setEnabled(bool enabled) -> void { Tracer::setEnabled(enabled); }
+inline auto save(const std::string& path) -> bool { return Tracer::instance().save(path); }
+
+/** File given with --trace=FILE on the command line, if any */
+inline auto fileFromArgs(int argc, char** argv) -> std::optional<std::string>
+{
+    constexpr std::string_view option = "--trace=";
+    for(int i = 1; i < argc; ++i){
+        const std::string_view arg = argv[i];
+        if(arg.substr(0, option.size()) == option){ return std::string(arg.substr(option.size())); }
+    }
+    return std::nullopt;
+}
+
+} // namespace trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#if TRACE_ENABLED
+// Span named `name` (a string literal) covering the rest of the enclosing scope
+#define TRACE_SCOPE(name) ::trace::Span TRACE_CONCAT(traceSpan_, __LINE__){name}
+#else
+#define TRACE_SCOPE(name) static_cast<void>(0)
+#endif